@@ -0,0 +1,83 @@
+#include "syscall.h"
+
+// Zicntr / hpmcounter CSRs, run with --hpm.
+//
+// The guest exits with a0 = instret read by its final CSR access,
+// so the test can compare it with the emulator's retired count:
+// after that read only the read itself and `li a7` retire (ECALL
+// traps and does not), so "Instructions:" must be exit code + 2.
+
+#define CYCLE 0xC00
+#define TIME 0xC01
+#define INSTRET 0xC02
+#define HPMCOUNTER3 0xC03 // loads
+#define HPMCOUNTER4 0xC04 // stores
+#define HPMCOUNTER7 0xC07 // unimplemented
+#define CYCLEH 0xC80
+#define INSTRETH 0xC82
+
+// csrrs rd, csr, x0 spelled with .insn, so the demo builds with
+// -march=rv32im on toolchains that want _zicsr for csrr.
+#define CSRR(rd, csr) ".insn i 0x73, 2, " rd ", x0, %[" csr "]\n"
+#define CSR_IMM(name, csr) [name] "i"((csr) - 0x1000)
+
+#define csr_read(csr)                                                 \
+    ({                                                                \
+        unsigned int v_;                                              \
+        __asm__ volatile(CSRR("%0", "c") : "=r"(v_) : CSR_IMM(c, csr) \
+                         : "memory");                                 \
+        v_;                                                           \
+    })
+
+static volatile unsigned int word = 7;
+
+int main()
+{
+    unsigned int a, b, t;
+
+    // Each retired instruction counts once, the first read included.
+    __asm__ volatile(CSRR("%0", "c")
+                     "nop\nnop\nnop\nnop\nnop\nnop\nnop\nnop\n"
+                     CSRR("%1", "c")
+                     : "=&r"(a), "=&r"(b)
+                     : CSR_IMM(c, INSTRET));
+    if (b - a != 9)
+        return fail("instret did not count 9 instructions");
+
+    if (csr_read(CYCLE) < csr_read(INSTRET))
+        return fail("cycle behind instret");
+    if (csr_read(CYCLEH) != 0 || csr_read(INSTRETH) != 0)
+        return fail("high halves of a short run not zero");
+
+    unsigned int t0 = csr_read(TIME);
+    for (volatile int i = 0; i < 100000; i++)
+        ;
+    if (csr_read(TIME) <= t0)
+        return fail("time did not advance");
+
+    __asm__ volatile(CSRR("%0", "c") "lw %2, 0(%3)\n" CSRR("%1", "c")
+                     : "=&r"(a), "=&r"(b), "=&r"(t)
+                     : "r"(&word), CSR_IMM(c, HPMCOUNTER3)
+                     : "memory");
+    if (b - a != 1)
+        return fail("hpmcounter3 did not count one load");
+
+    __asm__ volatile(CSRR("%0", "c") "sw %2, 0(%3)\n" CSRR("%1", "c")
+                     : "=&r"(a), "=&r"(b)
+                     : "r"(t), "r"(&word), CSR_IMM(c, HPMCOUNTER4)
+                     : "memory");
+    if (b - a != 1)
+        return fail("hpmcounter4 did not count one store");
+
+    if (csr_read(HPMCOUNTER7) != 0)
+        return fail("unimplemented hpmcounter7 not zero");
+
+    put("counters ok\n");
+
+    __asm__ volatile(CSRR("a0", "c") "li a7, 93\n"
+                     "ecall"
+                     :
+                     : CSR_IMM(c, INSTRET)
+                     : "a0", "a7", "memory");
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include "syscall.h"
+
+// Byte-at-a-time echo. The command byte 'b' reads into an
+// unmapped buffer, which must fail with -EFAULT (14) and leave
+// the guest - and every other guest of a --serve process -
+// running. 'S' stores to that buffer directly, which traps and
+// ends the guest.
+
+#define UNMAPPED ((char *)0x20000000)
+
+int main()
+{
+    char c;
+
+    while (SYS_READ(0, &c, 1) == 1)
+    {
+        if (c == 'S')
+            *(volatile char *)UNMAPPED = c;
+        if (c != 'b')
+        {
+            SYS_WRITE(1, &c, 1);
+            continue;
+        }
+
+        long r = SYS_READ(0, UNMAPPED, 10);
+        put(r == -14 ? "EFAULT\n" : "no fault\n");
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "syscall.h"
+
+// openat / fstat / mmap beneath --fs-root. Expects a fresh,
+// writable root containing a symlink "escape" that points out
+// of it (see the Makefile test target).
+
+#define AT_FDCWD -100
+#define O_RDWR 02
+#define O_CREAT 0100
+#define O_TRUNC 01000
+#define PROT_READ 1
+#define PROT_RW 3
+#define MAP_PRIVATE 2
+
+#define EACCES 13
+#define EFAULT 14
+#define EINVAL 22
+
+#define RAM_END 0x08000000
+
+#define FILE_SIZE 6000
+#define MAP_SIZE 8192
+
+static unsigned char buf[FILE_SIZE];
+
+static unsigned char pattern(long i)
+{
+    return (unsigned char)(i * 7 + 3);
+}
+
+int main()
+{
+    // Paths may not leave the root, lexically or via a symlink.
+    if (SYS_OPENAT(AT_FDCWD, "../outside", 0, 0) != -EACCES)
+        return fail("../ escaped the root");
+    if (SYS_OPENAT(AT_FDCWD, "/sub/../../outside", 0, 0) != -EACCES)
+        return fail("/sub/../../ escaped the root");
+    if (SYS_OPENAT(AT_FDCWD, "/etc/passwd", 0, 0) >= 0)
+        return fail("absolute path resolved on the host");
+    if (SYS_OPENAT(AT_FDCWD, "escape/passwd", 0, 0) >= 0)
+        return fail("symlink escaped the root");
+    if (SYS_OPENAT(AT_FDCWD, 0x20000000, 0, 0) != -EFAULT)
+        return fail("unmapped path did not fault");
+
+    long fd = SYS_OPENAT(AT_FDCWD, "data.bin", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return fail("create data.bin");
+
+    for (long i = 0; i < FILE_SIZE; i++)
+        buf[i] = pattern(i);
+    if (SYS_WRITE(fd, buf, FILE_SIZE) != FILE_SIZE)
+        return fail("write data.bin");
+
+    // struct kernel_stat: st_size at byte 48
+    unsigned int st[32];
+    if (SYS_FSTAT(fd, st) != 0 || st[12] != FILE_SIZE || st[13] != 0)
+        return fail("fstat size");
+
+    unsigned char *map = (unsigned char *)SYS_MMAP(0, MAP_SIZE, PROT_RW, MAP_PRIVATE, fd, 0);
+    if (IS_ERR(map))
+        return fail("mmap");
+
+    for (long i = 0; i < FILE_SIZE; i++)
+    {
+        if (map[i] != pattern(i))
+            return fail("mmap contents");
+    }
+    for (long i = FILE_SIZE; i < MAP_SIZE; i++)
+    {
+        if (map[i])
+            return fail("mmap past end-of-file not zero");
+    }
+
+    // A buffer straddling the end of the mapping: the first 6 bytes
+    // land in the mapping, the rest in the RAM above it.
+    unsigned char *edge = map + MAP_SIZE - 6;
+    if (SYS_PREAD(fd, edge, 16, 0) != 16)
+        return fail("pread across mapping edge");
+    for (long i = 0; i < 16; i++)
+    {
+        if (edge[i] != pattern(i))
+            return fail("pread across mapping edge: guest sees stale bytes");
+    }
+
+    // File mappings are unmapped whole, never split.
+    if (SYS_MUNMAP(map, 4096) != -EINVAL || SYS_MUNMAP(map + 4096, 4096) != -EINVAL)
+        return fail("partial munmap of a file mapping");
+    if (map[4096 + 1] != pattern(4096 + 1))
+        return fail("refused munmap changed the mapping");
+    if (SYS_MUNMAP(map, MAP_SIZE) != 0)
+        return fail("munmap");
+
+    // A write running off the end of RAM stops at the fault and
+    // reports what it wrote.
+    if (SYS_WRITE(fd, RAM_END - 5000, 8000) != 5000)
+        return fail("write across end of RAM");
+    if (SYS_FSTAT(fd, st) != 0 || st[12] != FILE_SIZE + 5000)
+        return fail("write across end of RAM: file size");
+
+    if (SYS_CLOSE(fd) != 0)
+        return fail("close");
+
+    // A file mapped read-only, then changed through another
+    // descriptor: the change shows through pages not yet copied,
+    // and a --replay of this run must still accept the file.
+    fd = SYS_OPENAT(AT_FDCWD, "data.bin", 0, 0);
+    if (fd < 0)
+        return fail("reopen data.bin");
+    map = (unsigned char *)SYS_MMAP(0, 4096, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (IS_ERR(map))
+        return fail("mmap read-only");
+    long wr = SYS_OPENAT(AT_FDCWD, "data.bin", O_RDWR, 0);
+    if (wr < 0 || SYS_PWRITE(wr, "X", 1, 1) != 1)
+        return fail("pwrite mapped file");
+    if (map[1] != 'X')
+        return fail("pwrite not visible through the mapping");
+    if (SYS_MUNMAP(map, 4096) != 0 || SYS_CLOSE(wr) != 0 || SYS_CLOSE(fd) != 0)
+        return fail("close mapped file");
+
+    put("files ok\n");
+    return 0;
+}
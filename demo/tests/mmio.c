@@ -0,0 +1,75 @@
+#include "syscall.h"
+
+// UART and CLINT through plain loads and stores.
+//
+// With 'f' on stdin it then floods the UART with FLOOD bytes and
+// exits, for checking that a slow --serve client loses nothing.
+
+#define UART ((volatile unsigned char *)0x10000000)
+#define UART_LSR 5
+#define LSR_THRE 0x20
+
+#define CLINT ((volatile unsigned int *)0x10010000)
+#define MTIMECMP (0x4000 / 4)
+#define MTIME (0xBFF8 / 4)
+
+#define UNCLAIMED ((volatile unsigned int *)0x10001000)
+
+#define FLOOD 200000
+
+static void uart_putc(char c)
+{
+    while (!(UART[UART_LSR] & LSR_THRE))
+        ;
+    UART[0] = c;
+}
+
+static void uart_puts(const char *s)
+{
+    while (*s)
+        uart_putc(*s++);
+}
+
+static unsigned long long mtime(void)
+{
+    unsigned int hi, lo;
+    do
+    {
+        hi = CLINT[MTIME + 1];
+        lo = CLINT[MTIME];
+    } while (hi != CLINT[MTIME + 1]);
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+int main()
+{
+    // UART output is flushed ahead of syscall output.
+    uart_puts("uart: ");
+    put("syscall\n");
+
+    unsigned long long t0 = mtime();
+    for (volatile int i = 0; i < 100000; i++)
+        ;
+    if (mtime() <= t0)
+        return fail("mtime did not advance");
+
+    CLINT[MTIMECMP] = 0x12345678;
+    CLINT[MTIMECMP + 1] = 9;
+    if (CLINT[MTIMECMP] != 0x12345678 || CLINT[MTIMECMP + 1] != 9)
+        return fail("mtimecmp did not hold its value");
+
+    *UNCLAIMED = 5;
+    if (*UNCLAIMED != 0)
+        return fail("unclaimed MMIO page did not read as zero");
+
+    uart_puts("mmio ok\n");
+
+    char c;
+    if (SYS_READ(0, &c, 1) == 1 && c == 'f')
+    {
+        for (int i = 0; i < FLOOD; i++)
+            uart_putc('x');
+        uart_puts("\nend\n");
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Raw Linux/RV32 syscalls, bypassing newlib, so tests see the
+// exact a0 the emulator returns (-errno rather than -1/errno).
+
+static inline long rv_syscall(long nr, long a0, long a1, long a2,
+                              long a3, long a4, long a5)
+{
+    register long r0 __asm__("a0") = a0;
+    register long r1 __asm__("a1") = a1;
+    register long r2 __asm__("a2") = a2;
+    register long r3 __asm__("a3") = a3;
+    register long r4 __asm__("a4") = a4;
+    register long r5 __asm__("a5") = a5;
+    register long r7 __asm__("a7") = nr;
+
+    __asm__ volatile("ecall"
+                     : "+r"(r0)
+                     : "r"(r1), "r"(r2), "r"(r3), "r"(r4), "r"(r5), "r"(r7)
+                     : "memory");
+    return r0;
+}
+
+#define SYS_OPENAT(dir, path, flags, mode) rv_syscall(56, (dir), (long)(path), (flags), (mode), 0, 0)
+#define SYS_CLOSE(fd) rv_syscall(57, (fd), 0, 0, 0, 0, 0)
+#define SYS_READ(fd, buf, len) rv_syscall(63, (fd), (long)(buf), (len), 0, 0, 0)
+#define SYS_WRITE(fd, buf, len) rv_syscall(64, (fd), (long)(buf), (len), 0, 0, 0)
+#define SYS_PREAD(fd, buf, len, off) rv_syscall(67, (fd), (long)(buf), (len), (off), 0, 0)
+#define SYS_PWRITE(fd, buf, len, off) rv_syscall(68, (fd), (long)(buf), (len), (off), 0, 0)
+#define SYS_FSTAT(fd, st) rv_syscall(80, (fd), (long)(st), 0, 0, 0, 0)
+#define SYS_MUNMAP(addr, len) rv_syscall(215, (long)(addr), (len), 0, 0, 0, 0)
+#define SYS_MMAP(addr, len, prot, flags, fd, pgoff) \
+    rv_syscall(222, (long)(addr), (len), (prot), (flags), (fd), (pgoff))
+
+#define IS_ERR(r) ((unsigned long)(r) >= (unsigned long)-4095)
+
+static inline void put(const char *s)
+{
+    long n = 0;
+    while (s[n])
+        n++;
+    SYS_WRITE(1, s, n);
+}
+
+static inline int fail(const char *what)
+{
+    put("FAIL: ");
+    put(what);
+    put("\n");
+    return 1;
+}
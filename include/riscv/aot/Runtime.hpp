@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "riscv/core/State.hpp"
+#include "riscv/memory/Memory.hpp"
+
+// ============================================================
+// Ahead-of-time translation runtime interface
+// ============================================================
+//
+// The offline translator (bin/translator) turns the text segment
+// of a static RV32IM ELF into C++ source. Each recovered basic
+// block becomes one host function that applies the block's
+// architectural effects to ArchitecturalState / MemorySubsystem
+// and leaves the successor address in state.pc.
+//
+// The generated translation unit defines the symbols declared
+// below; src/aot/main.cpp links against them and provides the
+// dispatch loop, the ELF image and the SyscallHandler (through
+// the regular CpuCore, which also executes everything that was
+// not translated: ECALL, SYSTEM and unknown encodings, and any
+// indirect-jump target that does not start a block).
+
+using AotBlockFn = void (*)(ArchitecturalState<32> &, MemorySubsystem<32> &);
+
+struct AotBlock
+{
+    uint32_t pc;     // guest address of the first instruction
+    uint32_t length; // number of instructions retired by fn
+    AotBlockFn fn;
+};
+
+// Executable range the translation was produced from.
+struct AotTextRange
+{
+    uint32_t base;
+    uint32_t size;
+};
+
+// ------------------------------------------------------------
+// Emitted by the translator
+// ------------------------------------------------------------
+
+extern const AotBlock aot_blocks[];
+extern const size_t aot_block_count;
+
+extern const AotTextRange aot_text[];
+extern const size_t aot_text_count;
+
+// FNV-1a over the translated text, used to refuse running the
+// translation against a different ELF than it was built from.
+extern const uint64_t aot_text_hash;
+
+// ELF path given to the translator (default image to load).
+extern const char *const aot_image_path;
+
+// ------------------------------------------------------------
+// Helpers shared by the translator and generated code
+// ------------------------------------------------------------
+
+inline uint64_t aot_hash_text(MemorySubsystem<32> &memory,
+                              const AotTextRange *ranges,
+                              size_t count)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < count; i++)
+    {
+        for (uint32_t a = 0; a < ranges[i].size; a++)
+        {
+            h ^= memory.read_byte(ranges[i].base + a);
+            h *= 0x100000001b3ull;
+        }
+    }
+    return h;
+}
+
+// RV32M division semantics (identical to ExecutionEngine).
+inline uint32_t aot_div(uint32_t a, uint32_t b)
+{
+    int32_t s1 = (int32_t)a;
+    int32_t s2 = (int32_t)b;
+    return b == 0 ? 0xFFFFFFFF : (s1 == INT32_MIN && s2 == -1) ? (uint32_t)INT32_MIN
+                                                               : (uint32_t)(s1 / s2);
+}
+
+inline uint32_t aot_divu(uint32_t a, uint32_t b)
+{
+    return b ? (a / b) : 0xFFFFFFFF;
+}
+
+inline uint32_t aot_rem(uint32_t a, uint32_t b)
+{
+    int32_t s1 = (int32_t)a;
+    int32_t s2 = (int32_t)b;
+    return b == 0 ? a : (s1 == INT32_MIN && s2 == -1) ? 0
+                                                      : (uint32_t)(s1 % s2);
+}
+
+inline uint32_t aot_remu(uint32_t a, uint32_t b)
+{
+    return b ? (a % b) : a;
+}
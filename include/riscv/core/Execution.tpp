@@ -4,6 +4,7 @@
 #include "riscv/core/Execution.hpp"
 #include "riscv/core/Instruction.hpp"
 #include "riscv/core/Trap.hpp"
+#include "riscv/platform/HostClock.hpp"
 
 // ============================================================
 // Shift helper (RV32 masks to 5 bits)
@@ -13,6 +14,45 @@ static inline uint32_t shamt(uint32_t v)
 {
     return v & 31;
 }
+// ============================================================
+// User-mode counter CSRs (see CounterFile)
+// ============================================================
+
+template <std::size_t XLEN>
+bool ArchitecturalState<XLEN>::read_csr(uint32_t csr, uint32_t &value) const
+{
+    if (csr < 0xC00 || csr > 0xC9F || (csr > 0xC1F && csr < 0xC80))
+        return false;
+
+    const bool high = csr >= 0xC80;
+    const uint32_t index = csr & 0x1F;
+    uint64_t v = 0;
+
+    switch (index)
+    {
+    case 0: // cycle
+        v = counters.instret + counters.stall_cycles;
+        break;
+    case 2: // instret
+        v = counters.instret;
+        break;
+    case 1: // time
+        v = counters.clock ? counters.clock->now() : 0;
+        break;
+    default:
+        if (index - 3 < static_cast<uint32_t>(HpmEvent::Count))
+            v = counters.events[index - 3];
+        break;
+    }
+
+    value = high ? (uint32_t)(v >> 32) : (uint32_t)v;
+
+    // instret is deterministic and time has its own HostClock tap.
+    if (counters.tap && index != 1 && index != 2)
+        value = counters.tap->counter(csr, value);
+    return true;
+}
+
 // ============================================================
 // RISC-V Instruction Semantics
 //
@@ -102,6 +142,7 @@ bool ExecutionEngine<XLEN>::execute(const DecodedInstruction &inst,
 
         if (take)
         {
+            state.counters.count(HpmEvent::TakenBranch);
             state.set_pc(pc + imm);
             pc_written = true;
         }
@@ -111,6 +152,7 @@ bool ExecutionEngine<XLEN>::execute(const DecodedInstruction &inst,
     case 0x03: // LOAD
     {
         uint32_t addr = state.reg(rs1) + imm;
+        state.counters.count(HpmEvent::Load);
 
         switch (funct3)
         {
@@ -139,6 +181,7 @@ bool ExecutionEngine<XLEN>::execute(const DecodedInstruction &inst,
     {
         uint32_t addr = state.reg(rs1) + imm;
         uint32_t val = state.reg(rs2);
+        state.counters.count(HpmEvent::Store);
 
         switch (funct3)
         {
@@ -208,6 +251,8 @@ bool ExecutionEngine<XLEN>::execute(const DecodedInstruction &inst,
             uint32_t u1 = a;
             uint32_t u2 = b;
 
+            state.counters.count(HpmEvent::MulDiv);
+
             switch (funct3)
             {
             case 0x0:
@@ -278,12 +323,26 @@ bool ExecutionEngine<XLEN>::execute(const DecodedInstruction &inst,
         break;
     }
 
-    case 0x73:
+    case 0x73: // SYSTEM: ECALL / Zicsr
+    {
         if (inst.is_ecall())
             throw Trap{TrapCause::Ecall, pc, 0, inst.raw};
-        else
+        if (funct3 == 0x4)
             throw Trap{TrapCause::IllegalInstruction, pc, 0, inst.raw};
 
+        // CSRRW(I) always writes; CSRRS/C(I) only with a non-zero
+        // rs1 / uimm (rs1 field either way).
+        const uint32_t csr = (uint32_t)imm & 0xFFF;
+        const bool writes = (funct3 & 0x3) == 0x1 || rs1 != 0;
+
+        uint32_t value;
+        if (!state.read_csr(csr, value) || (writes && State::csr_read_only(csr)))
+            throw Trap{TrapCause::IllegalInstruction, pc, 0, inst.raw};
+
+        state.set_reg(rd, value);
+        break;
+    }
+
     default:
         throw Trap{TrapCause::IllegalInstruction, pc, 0, inst.raw};
     }
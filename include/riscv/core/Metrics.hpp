@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "riscv/core/Instruction.hpp"
+#include "riscv/core/Timing.hpp"
+#include "riscv/core/Trap.hpp"
+#include "riscv/memory/Memory.hpp"
+
+// ============================================================
+// Emulator self-instrumentation
+//
+// Metrics is a plain bag of counters filled in by the emulator
+// itself (not visible to the guest):
+//
+//   - instructions by class          Instrumented<> timing policy
+//   - loads/stores by memory region  Instrumented<> timing policy
+//   - traps by TrapCause             CpuCore::step() trap path
+//   - syscalls by number, bytes
+//     moved and host time spent      SyscallHandler::handle()
+//
+// Everything is off unless a Metrics object is attached:
+// the per-instruction counters only exist in a CpuCore built with
+// the Instrumented<> policy, and the trap and syscall paths test
+// a pointer that stays null. The functional core is unchanged.
+//
+// MetricsExporter (riscv/platform/MetricsExporter.hpp) samples a
+// Metrics object periodically as JSON lines.
+// ============================================================
+
+enum class InstClass
+{
+    Alu,
+    AluImm,
+    Load,
+    Store,
+    Branch,
+    Jump,
+    Upper, // LUI, AUIPC
+    MulDiv,
+    System,
+    Other,
+    Count
+};
+
+inline const char *inst_class_name(InstClass c)
+{
+    static const char *names[] = {"alu", "alu_imm", "load", "store", "branch",
+                                  "jump", "upper", "muldiv", "system", "other"};
+    return names[static_cast<int>(c)];
+}
+
+inline InstClass classify(const DecodedInstruction &d)
+{
+    switch (d.opcode)
+    {
+    case 0x33:
+        return d.funct7 == 0x01 ? InstClass::MulDiv : InstClass::Alu;
+    case 0x13:
+        return InstClass::AluImm;
+    case 0x03:
+        return InstClass::Load;
+    case 0x23:
+        return InstClass::Store;
+    case 0x63:
+        return InstClass::Branch;
+    case 0x6F:
+    case 0x67:
+        return InstClass::Jump;
+    case 0x37:
+    case 0x17:
+        return InstClass::Upper;
+    case 0x73:
+        return InstClass::System;
+    default:
+        return InstClass::Other;
+    }
+}
+
+inline const char *trap_cause_name(TrapCause c)
+{
+    switch (c)
+    {
+    case TrapCause::IllegalInstruction:
+        return "illegal_instruction";
+    case TrapCause::LoadAccessFault:
+        return "load_access_fault";
+    case TrapCause::StoreAccessFault:
+        return "store_access_fault";
+    case TrapCause::MisalignedAccess:
+        return "misaligned_access";
+    case TrapCause::Ecall:
+        return "ecall";
+    }
+    return "unknown";
+}
+
+static constexpr size_t TRAP_CAUSE_COUNT = static_cast<size_t>(TrapCause::Ecall) + 1;
+
+struct Metrics
+{
+    struct RegionCounters
+    {
+        uint32_t base;
+        uint32_t size;
+        uint64_t loads = 0;
+        uint64_t stores = 0;
+    };
+
+    struct SyscallCounters
+    {
+        uint64_t calls = 0;
+        uint64_t blocked = 0; // returned SyscallStatus::Blocked (restarted later)
+        uint64_t bytes = 0;   // read/write payload
+        uint64_t host_ns = 0;
+    };
+
+    // Set when an Instrumented<> core feeds the counters below.
+    bool instrumented = false;
+
+    uint64_t classes[static_cast<size_t>(InstClass::Count)] = {};
+
+    // One entry per region of the memory map, plus a final entry
+    // for addresses outside it (accesses that fault; CpuCore counts
+    // those from the trap). mmap overlays lie inside the RAM region
+    // and are counted there.
+    std::vector<RegionCounters> regions;
+
+    // Ecall counts each ECALL once, however often it is restarted:
+    // it equals the sum of syscalls' calls minus blocked, plus the
+    // guests blocked right now.
+    uint64_t traps[TRAP_CAUSE_COUNT] = {};
+
+    std::map<uint32_t, SyscallCounters> syscalls;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t syscall_ns = 0;
+
+    // Serve mode only.
+    uint64_t guests_started = 0;
+    uint64_t guests_live = 0;
+
+    explicit Metrics(const MemoryMap &map)
+    {
+        for (const MemoryRegionDesc &r : map.regions)
+            regions.push_back({r.base, r.size});
+        regions.push_back({0, 0});
+    }
+
+    void count_access(uint32_t addr, bool store)
+    {
+        RegionCounters *r = &regions.back();
+        for (RegionCounters &c : regions)
+        {
+            if (addr - c.base < c.size)
+            {
+                r = &c;
+                break;
+            }
+        }
+        (store ? r->stores : r->loads)++;
+    }
+};
+
+// ------------------------------------------------------------
+// Instrumented<Inner>: timing policy that counts instruction
+// classes and memory accesses, then defers to Inner (the
+// functional no-op policy or TimingModel).
+// ------------------------------------------------------------
+
+template <typename Inner = FunctionalTiming>
+class Instrumented : public Inner
+{
+  public:
+    void attach(Metrics &m)
+    {
+        metrics = &m;
+        m.instrumented = true;
+    }
+
+    template <typename State>
+    void issue(uint32_t pc, const DecodedInstruction &d, const State &state)
+    {
+        if (d.opcode == 0x03 || d.opcode == 0x23)
+            mem_addr = state.reg(d.rs1) + d.imm;
+        Inner::issue(pc, d, state);
+    }
+
+    template <typename State>
+    void retire(uint32_t pc, const DecodedInstruction &d, State &state)
+    {
+        Inner::retire(pc, d, state);
+
+        InstClass c = classify(d);
+        metrics->classes[static_cast<size_t>(c)]++;
+        if (c == InstClass::Load || c == InstClass::Store)
+            metrics->count_access(mem_addr, c == InstClass::Store);
+    }
+
+  private:
+    Metrics *metrics = nullptr;
+    uint32_t mem_addr = 0;
+};
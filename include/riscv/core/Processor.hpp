@@ -6,6 +6,8 @@
 #include "riscv/memory/Memory.hpp"
 #include "riscv/core/Execution.hpp"
 #include "riscv/core/Instruction.hpp"
+#include "riscv/core/Metrics.hpp"
+#include "riscv/core/Timing.hpp"
 #include "riscv/platform/Syscall.hpp"
 
 // CpuCore implements the CPU front-end:
@@ -16,8 +18,12 @@
 // It intentionally does NOT implement instruction semantics.
 // Those live in ExecutionEngine, allowing precise control of
 // architectural state and PC updates.
+//
+// The Timing policy (see Timing.hpp) is a compile-time choice:
+// CpuCore<32> is the plain functional core, CpuCore<32,
+// TimingModel> additionally estimates cycles.
 
-template <size_t XLEN>
+template <size_t XLEN, typename Timing = FunctionalTiming>
 class CpuCore
 {
   public:
@@ -37,9 +43,35 @@ class CpuCore
         trace_out = o;
     }
 
+    // Backed by the instret CSR, so guests see the same count.
     uint64_t get_inst_count() const
     {
-        return inst_count;
+        return state.counters.instret;
+    }
+
+    // True if the last step() suspended on a blocking syscall
+    // (cooperative I/O only). See SyscallHandler::wait_fd().
+    bool is_waiting() const
+    {
+        return waiting;
+    }
+
+    SyscallHandler<State, Memory> &syscalls()
+    {
+        return syscall;
+    }
+
+    Timing &timing()
+    {
+        return timing_model;
+    }
+
+    // Count traps and syscalls into `m` (nullptr disables).
+    // Per-instruction counters need the Instrumented<> policy.
+    void set_metrics(Metrics *m)
+    {
+        metrics = m;
+        syscall.set_metrics(m);
     }
 
   private:
@@ -47,10 +79,12 @@ class CpuCore
     Memory &memory;
     ExecutionEngine<XLEN> executor;
     SyscallHandler<State, Memory> syscall;
+    Timing timing_model;
 
     bool trace = false;
     std::ostream *trace_out = nullptr;
-    uint64_t inst_count = 0;
+    bool waiting = false;
+    Metrics *metrics = nullptr;
 
     DecodedInstruction fetch_and_decode();
 };
@@ -9,12 +9,13 @@
 // CpuCore constructor
 // ------------------------------------------------------------
 
-template <size_t XLEN>
-CpuCore<XLEN>::CpuCore(State &state, Memory &memory)
+template <size_t XLEN, typename Timing>
+CpuCore<XLEN, Timing>::CpuCore(State &state, Memory &memory)
     : state(state),
       memory(memory),
       executor(),
-      syscall(memory)
+      syscall(memory),
+      timing_model()
 {
 }
 
@@ -22,8 +23,8 @@ CpuCore<XLEN>::CpuCore(State &state, Memory &memory)
 // Fetch + decode
 // ------------------------------------------------------------
 
-template <size_t XLEN>
-DecodedInstruction CpuCore<XLEN>::fetch_and_decode()
+template <size_t XLEN, typename Timing>
+DecodedInstruction CpuCore<XLEN, Timing>::fetch_and_decode()
 {
     uint32_t pc = state.pc;
     if (pc & 3)
@@ -53,6 +54,22 @@ inline void print_trace(std::ostream *out,
            << " imm=" << d.imm
            << "\n";
 }
+
+// ------------------------------------------------------------
+// Trap report (shared with translated-code runtimes)
+// ------------------------------------------------------------
+
+inline void print_trap(std::ostream &out, const Trap &t, uint64_t inst_count)
+{
+    out << "\n=== CPU TRAP ===\n";
+    out << "PC      = 0x" << std::hex << t.pc << "\n";
+    out << "Cause   = " << static_cast<int>(t.cause) << "\n";
+    out << "Address = 0x" << std::hex << t.addr << "\n";
+    out << "Inst    = 0x" << std::hex << t.inst << "\n";
+    out << "Instructions executed: " << std::dec << inst_count << "\n";
+    out << "=============\n";
+}
+
 // ------------------------------------------------------------
 // Execute one instruction
 // ------------------------------------------------------------
@@ -62,8 +79,8 @@ inline void print_trace(std::ostream *out,
 //   - ECALL is implemented as a synchronous exception
 //   - PC always reflects the faulting instruction on traps
 
-template <size_t XLEN>
-bool CpuCore<XLEN>::step()
+template <size_t XLEN, typename Timing>
+bool CpuCore<XLEN, Timing>::step()
 {
     try
     {
@@ -73,26 +90,39 @@ bool CpuCore<XLEN>::step()
         if (trace)
             print_trace<XLEN>(trace_out, pc, inst);
 
+        timing_model.issue(pc, inst, state);
         executor.execute(inst, pc, state, memory);
-        inst_count++;
+        timing_model.retire(pc, inst, state);
+        state.counters.instret++;
         return true;
     }
     catch (const Trap &t)
     {
+        // A restarted ECALL (waiting is still set) was counted when
+        // it first trapped.
+        if (metrics && !(waiting && t.cause == TrapCause::Ecall))
+            metrics->traps[static_cast<size_t>(t.cause)]++;
+
+        // A load or store that faults never retires, so the timing
+        // policy does not see it; count its address here.
+        if (metrics && metrics->instrumented &&
+            (t.cause == TrapCause::LoadAccessFault || t.cause == TrapCause::StoreAccessFault))
+            metrics->count_access(t.addr, t.cause == TrapCause::StoreAccessFault);
+
         if (t.cause == TrapCause::Ecall)
         {
-            bool cont = syscall.handle(state);
+            SyscallStatus status = syscall.handle(state);
+            waiting = (status == SyscallStatus::Blocked);
+            if (waiting)
+            {
+                state.set_pc(t.pc); // restart the ecall once the fd is ready
+                return true;
+            }
             state.set_pc(t.pc + 4); // resume after ecall
-            return cont;
+            return status == SyscallStatus::Continue;
         }
 
-        std::cerr << "\n=== CPU TRAP ===\n";
-        std::cerr << "PC      = 0x" << std::hex << t.pc << "\n";
-        std::cerr << "Cause   = " << static_cast<int>(t.cause) << "\n";
-        std::cerr << "Address = 0x" << std::hex << t.addr << "\n";
-        std::cerr << "Inst    = 0x" << std::hex << t.inst << "\n";
-        std::cerr << "Instructions executed: " << inst_count << "\n";
-        std::cerr << "=============\n";
+        print_trap(std::cerr, t, state.counters.instret);
         return false;
     }
 }
@@ -4,9 +4,61 @@
 #include <stdexcept>
 #include <sstream>
 
+class HostClock;
+
 constexpr std::size_t N_GEN_PURPOSE_REGS = 32;
 
-// Architectural State: registers, PC, future CSRs
+// ============================================================
+// User-mode counters (Zicntr + hpmcounters)
+// ============================================================
+//
+//   cycle    0xC00  instret + stall_cycles (stalls come from the
+//                   timing model; always 0 in functional mode)
+//   time     0xC01  HostClock ticks (same clock as the CLINT)
+//   instret  0xC02  instructions retired by CpuCore
+//   hpmcounter3..6  0xC03-0xC06  loads, stores, taken branches,
+//                   mul/div (only counted if count_events is set)
+//   hpmcounter7..31 read as zero
+//
+// High halves live at 0xC80-0xC9F. All are read-only.
+//
+// cycle and the hpmcounters depend on how the emulator is run
+// (--timing, --hpm), not only on the guest. A CounterTap sees
+// each value read from them and may replace it; ReplayLog uses
+// this so a replay reads what the recorded run read.
+
+enum class HpmEvent
+{
+    Load,
+    Store,
+    TakenBranch,
+    MulDiv,
+    Count
+};
+
+struct CounterTap
+{
+    virtual ~CounterTap() = default;
+    virtual uint32_t counter(uint32_t csr, uint32_t value) = 0;
+};
+
+struct CounterFile
+{
+    uint64_t instret = 0;
+    uint64_t stall_cycles = 0;
+    uint64_t events[static_cast<int>(HpmEvent::Count)]{};
+    bool count_events = false;
+    const HostClock *clock = nullptr;
+    CounterTap *tap = nullptr;
+
+    void count(HpmEvent e)
+    {
+        if (count_events)
+            events[static_cast<int>(e)]++;
+    }
+};
+
+// Architectural State: registers, PC, CSRs
 template <std::size_t XLEN>
 struct ArchitecturalState
 {
@@ -16,6 +68,7 @@ struct ArchitecturalState
 
     RegType x[N_GEN_PURPOSE_REGS]{};
     RegType pc{};
+    CounterFile counters;
 
     // ===== Register Access =====
     RegType reg(std::size_t i) const
@@ -46,6 +99,18 @@ struct ArchitecturalState
         pc = value;
     }
 
+    // ===== CSR Access =====
+    // Returns false for CSRs that do not exist (illegal instruction).
+    // Defined with the Zicsr instructions in Execution.tpp, the only
+    // code that reads the clock.
+    bool read_csr(uint32_t csr, uint32_t &value) const;
+
+    // Every implemented CSR is a user-level read-only counter.
+    static bool csr_read_only(uint32_t csr)
+    {
+        return (csr >> 10) == 0x3;
+    }
+
     // ===== Trap Handling =====
     [[noreturn]] void raise_trap() const
     {
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include "riscv/core/Instruction.hpp"
+
+// ============================================================
+// Timing policy for CpuCore
+//
+// CpuCore is parameterised on a timing policy that observes
+// every retired instruction:
+//
+//   issue(pc, inst, state)   before execution (operands intact)
+//   retire(pc, inst, state)  after execution (state.pc = next PC)
+//
+// FunctionalTiming is the default: its hooks are empty and
+// inline away, so the functional emulator pays nothing.
+// TimingModel (riscv/timing/TimingModel.hpp) estimates cycles.
+// ============================================================
+
+struct FunctionalTiming
+{
+    template <typename State>
+    void issue(uint32_t, const DecodedInstruction &, const State &)
+    {
+    }
+
+    template <typename State>
+    void retire(uint32_t, const DecodedInstruction &, State &)
+    {
+    }
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// ============================================================
+// MmioDevice
+//
+// A memory-mapped device on the MemorySubsystem device bus.
+// Devices claim one or more whole 4 KiB pages inside an MMIO
+// region (MemorySubsystem::attach_device). An access inside the
+// MMIO window reaches its device with a single page-table lookup,
+// without searching the memory map, and is passed the offset
+// from the device's base address.
+//
+// Accesses are 1, 2 or 4 bytes wide, little-endian.
+// ============================================================
+
+class MmioDevice
+{
+  public:
+    virtual ~MmioDevice() = default;
+
+    virtual uint32_t read(uint32_t offset, unsigned size) = 0;
+    virtual void write(uint32_t offset, uint32_t value, unsigned size) = 0;
+
+    // Push any buffered output to the host. Called before the
+    // guest performs syscall I/O so output stays ordered.
+    virtual void flush() {}
+};
@@ -6,6 +6,7 @@
 #include <type_traits>
 
 #include "riscv/core/Trap.hpp"
+#include "riscv/memory/Device.hpp"
 
 // ============================================================
 // MemorySubsystem
@@ -19,6 +20,17 @@
 //   - alignment rules
 //   - device I/O dispatch
 //
+// MMIO accesses are routed through a device bus: one slot per
+// 4 KiB page of the window spanned by the MMIO regions, naming
+// the device that claims it. Every access first checks that
+// window (one subtract and compare) and, inside it, indexes the
+// bus directly; no region is searched. Unclaimed MMIO reads
+// return 0 and writes are ignored.
+//
+// Host overlays (map_host) are kept apart from the memory map.
+// They are only searched for addresses inside the span they
+// cover, so RAM outside the mmap area never looks at them.
+//
 // This mirrors how a real OS kernel mediates memory access.
 // ============================================================
 enum class MemoryRegionType
@@ -46,6 +58,7 @@ struct MemoryRegion
     uint32_t size;
     MemoryRegionType type;
     uint8_t *data; // nullptr for MMIO
+    bool owned;    // false for host-provided overlays (map_host)
 };
 
 // ------------------------------------------------------------
@@ -88,10 +101,55 @@ class MemorySubsystem
     bool is_mapped(AddrType addr, size_t size) const;
     void memset(AddrType addr, uint8_t value, size_t size);
 
+    // Bulk access: host pointer to [addr, addr+size) if the whole
+    // range lies in a single RAM region and no overlay shadows part
+    // of it, nullptr otherwise.
+    uint8_t *host_range(AddrType addr, size_t size);
+
+    // Overlay host memory (e.g. an mmap()ed file) at [addr, addr+size).
+    // Overlays shadow the regions below them and are not freed by
+    // the subsystem; the caller keeps ownership of `host`.
+    void map_host(AddrType addr, uint32_t size, uint8_t *host);
+    bool unmap_host(AddrType addr);
+
+    // Device bus. [base, base+size) must be page-aligned and lie
+    // inside an MMIO region. The device is not owned.
+    void attach_device(AddrType base, uint32_t size, MmioDevice &dev);
+    void flush_devices();
+
+    static constexpr uint32_t BUS_PAGE_SHIFT = 12;
+
   private:
-    std::vector<MemoryRegion> regions;
-    bool handle_mmio_write(AddrType addr, uint8_t value);
+    // One slot per page of [mmio_base, mmio_base + mmio_span).
+    struct BusPage
+    {
+        MmioDevice *dev;
+        uint32_t dev_base; // guest address the device was attached at
+        bool mapped;       // inside an MMIO region (the window may have gaps)
+    };
+
+    std::vector<MemoryRegion> regions; // the memory map, in order
+    std::vector<MemoryRegion> overlays;
+    AddrType overlay_base = 0;
+    AddrType overlay_span = 0; // 0: no overlays
+
+    AddrType mmio_base = 0;
+    AddrType mmio_span = 0;
+    std::vector<BusPage> bus;
+    std::vector<MmioDevice *> devices;
+
+    // Bus slot for `addr`, or nullptr outside the MMIO window.
+    const BusPage *bus_page(AddrType addr) const
+    {
+        AddrType off = addr - mmio_base;
+        return off < mmio_span ? &bus[off >> BUS_PAGE_SHIFT] : nullptr;
+    }
+
     MemoryRegion *find_region(AddrType addr, size_t size);
+    MemoryRegion *find_overlay(AddrType addr, size_t size);
+    void update_overlay_span();
+    uint32_t mmio_read(const BusPage &p, AddrType addr, unsigned size);
+    void mmio_write(const BusPage &p, AddrType addr, uint32_t value, unsigned size);
 };
 
 #include "Memory.tpp"
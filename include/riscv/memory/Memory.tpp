@@ -1,6 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <new>
+#include <stdexcept>
 #include "riscv/core/Trap.hpp"
 
 // ------------------------------------------------------------
@@ -10,52 +15,119 @@
 template <size_t XLEN>
 MemorySubsystem<XLEN>::MemorySubsystem(const MemoryMap &map)
 {
+    AddrType mmio_end = 0;
+
     for (const auto &desc : map.regions)
     {
         MemoryRegion r;
         r.base = desc.base;
         r.size = desc.size;
         r.type = desc.type;
+        r.owned = true;
 
+        // calloc() lets the host hand out zero pages lazily, so an
+        // idle guest only costs the memory it has actually touched.
         if (desc.type == MemoryRegionType::RAM)
-            r.data = new uint8_t[desc.size]();
+        {
+            r.data = static_cast<uint8_t *>(std::calloc(desc.size, 1));
+            if (!r.data)
+                throw std::bad_alloc();
+        }
         else
+        {
             r.data = nullptr;
+            if (!mmio_span || desc.base < mmio_base)
+                mmio_base = desc.base;
+            if (!mmio_span || desc.base + desc.size > mmio_end)
+                mmio_end = desc.base + desc.size;
+            mmio_span = mmio_end - mmio_base;
+        }
 
         regions.push_back(r);
     }
+
+    // The bus covers the whole MMIO window; pages between MMIO
+    // regions stay unmapped and fault like any other hole.
+    bus.resize((mmio_span + 0xFFF) >> BUS_PAGE_SHIFT, BusPage{nullptr, 0, false});
+    for (const auto &r : regions)
+    {
+        if (r.type != MemoryRegionType::MMIO)
+            continue;
+        for (AddrType a = r.base; a - r.base < r.size; a += 1u << BUS_PAGE_SHIFT)
+            bus[(a - mmio_base) >> BUS_PAGE_SHIFT].mapped = true;
+    }
 }
 
 template <size_t XLEN>
 MemorySubsystem<XLEN>::~MemorySubsystem()
 {
     for (auto &r : regions)
-        delete[] r.data;
+    {
+        if (r.owned)
+            std::free(r.data);
+    }
 }
 
 // ------------------------------------------------------------
 // Helpers
 // ------------------------------------------------------------
 
-// MMIO handler for platform devices (UART, etc)
+// Device bus dispatch: page slot -> device, offset from its base.
 template <size_t XLEN>
-bool MemorySubsystem<XLEN>::handle_mmio_write(AddrType addr, uint8_t value)
+uint32_t MemorySubsystem<XLEN>::mmio_read(const BusPage &p, AddrType addr, unsigned size)
 {
-    // UART at 0x10000000
-    if (addr == 0x10000000)
-    {
-        std::cout << static_cast<char>(value);
-        std::cout.flush();
-        return true;
-    }
-    return false;
+    if (!p.mapped)
+        throw Trap{TrapCause::LoadAccessFault, 0, (uint32_t)addr, 0};
+    if (!p.dev)
+        return 0;
+    return p.dev->read(addr - p.dev_base, size);
+}
+
+template <size_t XLEN>
+void MemorySubsystem<XLEN>::mmio_write(const BusPage &p, AddrType addr, uint32_t value, unsigned size)
+{
+    if (!p.mapped)
+        throw Trap{TrapCause::StoreAccessFault, 0, (uint32_t)addr, 0};
+    if (p.dev)
+        p.dev->write(addr - p.dev_base, value, size);
+}
+
+template <size_t XLEN>
+void MemorySubsystem<XLEN>::attach_device(AddrType base, uint32_t size, MmioDevice &dev)
+{
+    if ((base | size) & 0xFFF)
+        throw std::invalid_argument("MMIO device range must be page-aligned");
+
+    MemoryRegion *r = find_region(base, size);
+    if (!r || r->type != MemoryRegionType::MMIO)
+        throw std::invalid_argument("MMIO device outside an MMIO region");
+
+    uint32_t first = (base - mmio_base) >> BUS_PAGE_SHIFT;
+    for (uint32_t i = 0; i < (size >> BUS_PAGE_SHIFT); i++)
+        bus[first + i] = BusPage{&dev, (uint32_t)base, true};
+
+    devices.push_back(&dev);
+}
+
+template <size_t XLEN>
+void MemorySubsystem<XLEN>::flush_devices()
+{
+    for (MmioDevice *d : devices)
+        d->flush();
 }
 
-// Locate the region covering [addr, addr+size).
+// Locate the region covering [addr, addr+size): an overlay if one
+// shadows it, else a region of the memory map.
 // Returns nullptr if no region maps this address range.
 template <size_t XLEN>
-MemoryRegion *MemorySubsystem<XLEN>::find_region(AddrType addr, size_t size)
+inline MemoryRegion *MemorySubsystem<XLEN>::find_region(AddrType addr, size_t size)
 {
+    if (addr - overlay_base < overlay_span)
+    {
+        if (MemoryRegion *o = find_overlay(addr, size))
+            return o;
+    }
+
     for (auto &r : regions)
     {
         if (addr >= r.base &&
@@ -65,6 +137,19 @@ MemoryRegion *MemorySubsystem<XLEN>::find_region(AddrType addr, size_t size)
     return nullptr;
 }
 
+// Only reached for addresses inside the overlay span.
+template <size_t XLEN>
+MemoryRegion *MemorySubsystem<XLEN>::find_overlay(AddrType addr, size_t size)
+{
+    for (auto &o : overlays)
+    {
+        if (addr >= o.base &&
+            addr + size <= o.base + o.size)
+            return &o;
+    }
+    return nullptr;
+}
+
 template <size_t XLEN>
 bool MemorySubsystem<XLEN>::is_mapped(AddrType addr, size_t size) const
 {
@@ -84,13 +169,13 @@ bool MemorySubsystem<XLEN>::is_mapped(AddrType addr, size_t size) const
 template <size_t XLEN>
 uint8_t MemorySubsystem<XLEN>::read_byte(AddrType addr)
 {
+    if (const BusPage *p = bus_page(addr))
+        return mmio_read(*p, addr, 1);
+
     MemoryRegion *r = find_region(addr, 1);
     if (!r)
         throw Trap{TrapCause::LoadAccessFault, 0, (uint32_t)addr, 0};
 
-    if (r->type == MemoryRegionType::MMIO)
-        return 0;
-
     return r->data[addr - r->base];
 }
 
@@ -100,6 +185,9 @@ uint32_t MemorySubsystem<XLEN>::read_half(AddrType addr)
     if (addr & 1)
         throw Trap{TrapCause::MisalignedAccess, 0, (uint32_t)addr, 0};
 
+    if (const BusPage *p = bus_page(addr))
+        return mmio_read(*p, addr, 2) & 0xFFFF;
+
     MemoryRegion *r = find_region(addr, 2);
     if (!r)
         throw Trap{TrapCause::LoadAccessFault, 0, (uint32_t)addr, 0};
@@ -114,6 +202,9 @@ uint32_t MemorySubsystem<XLEN>::read_word(AddrType addr)
     if (addr & 3)
         throw Trap{TrapCause::MisalignedAccess, 0, (uint32_t)addr, 0};
 
+    if (const BusPage *p = bus_page(addr))
+        return mmio_read(*p, addr, 4);
+
     MemoryRegion *r = find_region(addr, 4);
     if (!r)
         throw Trap{TrapCause::LoadAccessFault, 0, (uint32_t)addr, 0};
@@ -132,15 +223,16 @@ uint32_t MemorySubsystem<XLEN>::read_word(AddrType addr)
 template <size_t XLEN>
 bool MemorySubsystem<XLEN>::write_byte(AddrType addr, uint8_t value)
 {
+    if (const BusPage *p = bus_page(addr))
+    {
+        mmio_write(*p, addr, value, 1);
+        return true;
+    }
+
     MemoryRegion *r = find_region(addr, 1);
     if (!r)
         throw Trap{TrapCause::StoreAccessFault, 0, (uint32_t)addr, 0};
 
-    if (r->type == MemoryRegionType::MMIO)
-    {
-        return handle_mmio_write(addr, value);
-    }
-
     r->data[addr - r->base] = value;
     return true;
 }
@@ -151,6 +243,12 @@ bool MemorySubsystem<XLEN>::write_half(AddrType addr, uint16_t value)
     if (addr & 1)
         throw Trap{TrapCause::MisalignedAccess, 0, (uint32_t)addr, 0};
 
+    if (const BusPage *p = bus_page(addr))
+    {
+        mmio_write(*p, addr, value, 2);
+        return true;
+    }
+
     MemoryRegion *r = find_region(addr, 2);
     if (!r)
         throw Trap{TrapCause::StoreAccessFault, 0, (uint32_t)addr, 0};
@@ -167,6 +265,12 @@ bool MemorySubsystem<XLEN>::write_word(AddrType addr, uint32_t value)
     if (addr & 3)
         throw Trap{TrapCause::MisalignedAccess, 0, (uint32_t)addr, 0};
 
+    if (const BusPage *p = bus_page(addr))
+    {
+        mmio_write(*p, addr, value, 4);
+        return true;
+    }
+
     MemoryRegion *r = find_region(addr, 4);
     if (!r)
         throw Trap{TrapCause::StoreAccessFault, 0, (uint32_t)addr, 0};
@@ -182,6 +286,74 @@ bool MemorySubsystem<XLEN>::write_word(AddrType addr, uint32_t value)
 template <size_t XLEN>
 void MemorySubsystem<XLEN>::memset(AddrType addr, uint8_t value, size_t size)
 {
+    if (uint8_t *p = host_range(addr, size))
+    {
+        std::memset(p, value, size);
+        return;
+    }
+
     for (size_t i = 0; i < size; i++)
         write_byte(addr + i, value);
 }
+
+// ------------------------------------------------------------
+// Bulk access and host overlays
+// ------------------------------------------------------------
+
+template <size_t XLEN>
+uint8_t *MemorySubsystem<XLEN>::host_range(AddrType addr, size_t size)
+{
+    MemoryRegion *r = find_region(addr, size);
+    if (!r || r->type != MemoryRegionType::RAM)
+        return nullptr;
+
+    // A range that runs into an overlay is only partly backed by
+    // `r`: the region below holds stale bytes for the shadowed part.
+    if (r->owned && addr < overlay_base + overlay_span && overlay_base < addr + size)
+    {
+        for (const MemoryRegion &o : overlays)
+        {
+            if (addr < o.base + o.size && o.base < addr + size)
+                return nullptr;
+        }
+    }
+
+    return r->data + (addr - r->base);
+}
+
+template <size_t XLEN>
+void MemorySubsystem<XLEN>::map_host(AddrType addr, uint32_t size, uint8_t *host)
+{
+    overlays.push_back(MemoryRegion{(uint32_t)addr, size, MemoryRegionType::RAM, host, false});
+    update_overlay_span();
+}
+
+template <size_t XLEN>
+bool MemorySubsystem<XLEN>::unmap_host(AddrType addr)
+{
+    for (auto it = overlays.begin(); it != overlays.end(); ++it)
+    {
+        if (it->base == addr)
+        {
+            overlays.erase(it);
+            update_overlay_span();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Smallest window holding every overlay, checked before searching them.
+template <size_t XLEN>
+void MemorySubsystem<XLEN>::update_overlay_span()
+{
+    AddrType lo = overlays.empty() ? 0 : overlays[0].base;
+    AddrType hi = lo;
+    for (const MemoryRegion &o : overlays)
+    {
+        lo = std::min<AddrType>(lo, o.base);
+        hi = std::max<AddrType>(hi, o.base + o.size);
+    }
+    overlay_base = lo;
+    overlay_span = hi - lo;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include "riscv/memory/Device.hpp"
+#include "riscv/platform/HostClock.hpp"
+
+// ============================================================
+// Clint
+//
+// CLINT-compatible timer block, so guests can read time with a
+// plain load instead of an ECALL.
+//
+//   +0x4000  mtimecmp (64-bit, stored only: no interrupt model)
+//   +0xBFF8  mtime    (64-bit, HostClock ticks, read-only)
+//
+// 64-bit registers are accessed as two 32-bit halves; guests
+// should use the usual hi/lo/hi read loop.
+// ============================================================
+
+class Clint : public MmioDevice
+{
+  public:
+    static constexpr uint32_t SIZE = 0x10000;
+    static constexpr uint32_t MTIMECMP = 0x4000;
+    static constexpr uint32_t MTIME = 0xBFF8;
+
+    explicit Clint(const HostClock &c)
+        : clock(c)
+    {
+    }
+
+    uint32_t read(uint32_t offset, unsigned) override
+    {
+        switch (offset)
+        {
+        case MTIME:
+            return (uint32_t)clock.now();
+        case MTIME + 4:
+            return (uint32_t)(clock.now() >> 32);
+        case MTIMECMP:
+            return (uint32_t)mtimecmp;
+        case MTIMECMP + 4:
+            return (uint32_t)(mtimecmp >> 32);
+        default:
+            return 0;
+        }
+    }
+
+    void write(uint32_t offset, uint32_t value, unsigned) override
+    {
+        if (offset == MTIMECMP)
+            mtimecmp = (mtimecmp & ~0xFFFFFFFFull) | value;
+        else if (offset == MTIMECMP + 4)
+            mtimecmp = (mtimecmp & 0xFFFFFFFFull) | ((uint64_t)value << 32);
+    }
+
+  private:
+    const HostClock &clock;
+    uint64_t mtimecmp = ~0ull;
+};
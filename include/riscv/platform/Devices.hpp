@@ -0,0 +1,33 @@
+#pragma once
+
+#include "riscv/memory/Memory.hpp"
+#include "riscv/platform/Clint.hpp"
+#include "riscv/platform/HostClock.hpp"
+#include "riscv/platform/MemoryLayout.hpp"
+#include "riscv/platform/Uart.hpp"
+
+// ============================================================
+// PlatformDevices
+//
+// The standard device set of the default memory layout.
+// Must outlive every access to the MemorySubsystem it is
+// attached to.
+// ============================================================
+
+struct PlatformDevices
+{
+    HostClock clock;
+    Uart uart;
+    Clint clint;
+
+    explicit PlatformDevices(int uart_fd = 1)
+        : clock(), uart(uart_fd), clint(clock)
+    {
+    }
+
+    void attach(MemorySubsystem<32> &memory)
+    {
+        memory.attach_device(UART_BASE, 0x1000, uart);
+        memory.attach_device(CLINT_BASE, Clint::SIZE, clint);
+    }
+};
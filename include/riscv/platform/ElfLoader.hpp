@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 #include "riscv/memory/Memory.hpp"
 #include "riscv/core/State.hpp"
 
@@ -21,10 +22,37 @@
 //
 // This allows unmodified toolchain output to run directly.
 
+// A PT_LOAD segment as it was mapped into the address space.
+struct ElfSegment
+{
+    uint32_t vaddr;
+    uint32_t memsz;
+    bool executable;
+};
+
+// A function symbol from .symtab (STT_FUNC).
+struct ElfSymbol
+{
+    std::string name;
+    uint32_t addr;
+    uint32_t size;
+};
+
+// Optional image description filled in by load().
+// Used by offline tools (translator) and profilers; the
+// emulator itself does not need it.
+struct ElfImageInfo
+{
+    uint32_t entry = 0;
+    std::vector<ElfSegment> segments;
+    std::vector<ElfSymbol> functions; // sorted by address
+};
+
 class ElfLoader
 {
   public:
     static bool load(const std::string &path,
                      MemorySubsystem<32> &memory,
-                     ArchitecturalState<32> &state);
+                     ArchitecturalState<32> &state,
+                     ElfImageInfo *info = nullptr);
 };
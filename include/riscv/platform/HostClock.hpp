@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <time.h>
+
+// ============================================================
+// HostClock
+//
+// Guest-visible wall time, derived from the host monotonic
+// clock (a vDSO call on Linux, no syscall). Ticks are 1 us and
+// count from construction, so every guest starts at time 0.
+//
+// A Tap sees every value handed to the guest and may replace
+// it; ReplayLog uses this to record and replay guest time.
+// ============================================================
+
+class HostClock
+{
+  public:
+    static constexpr uint64_t TICKS_PER_SECOND = 1000000;
+
+    struct Tap
+    {
+        virtual ~Tap() = default;
+        virtual uint64_t time(uint64_t now) = 0;
+    };
+
+    HostClock()
+        : epoch(host_us())
+    {
+    }
+
+    uint64_t now() const
+    {
+        uint64_t t = host_us() - epoch;
+        return tap ? tap->time(t) : t;
+    }
+
+    void set_tap(Tap *t)
+    {
+        tap = t;
+    }
+
+  private:
+    uint64_t epoch;
+    Tap *tap = nullptr;
+
+    static uint64_t host_us()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * TICKS_PER_SECOND + (uint64_t)ts.tv_nsec / 1000;
+    }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "riscv/memory/Memory.hpp"
+
+// ============================================================
+// Default user-mode memory layout
+// ============================================================
+//
+// Shared by every host frontend (emulator, translated binaries)
+// so that guests observe exactly the same address space.
+//
+//   0x00000000  text + rodata     (4 MiB)
+//   0x00400000  data/heap/stack   (124 MiB)
+//   0x10000000  MMIO device bus   (128 KiB)
+//     0x10000000  UART
+//     0x10010000  CLINT (mtime at +0xBFF8)
+
+constexpr uint32_t MMIO_BASE = 0x10000000;
+constexpr uint32_t MMIO_SIZE = 0x20000;
+constexpr uint32_t UART_BASE = 0x10000000;
+constexpr uint32_t CLINT_BASE = 0x10010000;
+
+inline MemoryMap default_memory_map()
+{
+    return MemoryMap{
+        {
+            {0x00000000, 4 * 1024 * 1024, MemoryRegionType::RAM},   // program
+            {0x00400000, 124 * 1024 * 1024, MemoryRegionType::RAM}, // stack + heap
+            {MMIO_BASE, MMIO_SIZE, MemoryRegionType::MMIO},         // devices
+        }};
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "riscv/core/Metrics.hpp"
+#include "riscv/platform/HostClock.hpp"
+
+// ============================================================
+// MetricsExporter
+//
+// Writes periodic snapshots of a Metrics object as JSON lines,
+// one object per sample, to either
+//   - a file (appended), or
+//   - "unix:/path": a SOCK_STREAM Unix socket a collector is
+//     listening on.
+//
+// Counters are cumulative since start; "ips" is the rate over
+// the last interval. The socket is non-blocking: if the
+// collector falls behind, lines are queued up to a limit and
+// then dropped (and counted) rather than stalling the guest.
+//
+// The emulator polls due() between batches of instructions,
+// so sampling costs one clock read per batch.
+// ============================================================
+
+class MetricsExporter
+{
+  public:
+    // Throws std::runtime_error if the target cannot be opened.
+    MetricsExporter(const std::string &target, uint64_t interval_ms);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter &) = delete;
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+    bool due() const
+    {
+        return clock.now() >= next_us;
+    }
+
+    // Milliseconds until the next sample is due (0 if overdue).
+    int until_due_ms() const;
+
+    // Emit one line and schedule the next sample.
+    void sample(const Metrics &m, uint64_t instret);
+
+  private:
+    static constexpr size_t MAX_PENDING = 1 << 20;
+
+    int fd = -1;
+    bool is_socket = false;
+
+    HostClock clock;
+    uint64_t interval_us;
+    uint64_t next_us;
+    uint64_t last_us = 0;
+    uint64_t last_instret = 0;
+
+    std::string pending;
+    uint64_t dropped = 0;
+
+    void send_pending();
+};
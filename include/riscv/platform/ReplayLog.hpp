@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "riscv/core/State.hpp"
+#include "riscv/platform/HostClock.hpp"
+
+// ============================================================
+// ReplayLog
+//
+// Records every nondeterministic input a guest receives, in the
+// order it receives it, so a run can be reproduced exactly:
+//
+//   S  one per syscall: number, a0 result, a hash of the bytes a
+//      write()/pwrite() sends out, the identity of a file mapped
+//      by mmap(), and the bytes the syscall wrote into guest
+//      memory (read data, fstat buffers)
+//   T  one per guest time read (time CSR, CLINT mtime)
+//   C  one per cycle / hpmcounter CSR read: these depend on
+//      --timing and --hpm, so replay hands back the recorded
+//      values whatever the replaying run is configured with
+//
+// In replay mode SyscallHandler takes host-dependent results from
+// the log instead of the host, and HostClock returns the logged
+// times. Deterministic syscalls (brk, anonymous mmap, munmap,
+// exit) still run and are checked against the log, as are write
+// payloads, so a guest that diverges (different ELF, different
+// engine bug) is caught at the first mismatch.
+//
+// File-backed mmap() of a file the guest has not opened for
+// writing is logged by path (relative to --fs-root), size and
+// mtime rather than by contents. If the guest opens and changes
+// the file later in the run, the logged size and mtime are
+// updated in place, so they describe the file as the recording
+// left it: that is what replay finds on disk, maps again, and
+// refuses to run if it differs.
+//
+// Format: "RVRL", version byte, 64-bit FNV-1a hash of the ELF
+// file, then tagged records with LEB128 fields (a mapped file's
+// size and mtime are fixed 64-bit fields so they can be
+// rewritten). Records are buffered and written out at every
+// syscall boundary, at the end of the run, and when SIGINT,
+// SIGTERM or SIGHUP stops the recording; a failed write throws
+// rather than leaving a silently truncated log. Nothing is
+// logged per instruction.
+// ============================================================
+
+class ReplayLog : public HostClock::Tap, public CounterTap
+{
+  public:
+    enum class Mode
+    {
+        Record,
+        Replay
+    };
+
+    // A host file overlaid onto the guest by mmap().
+    struct MappedFile
+    {
+        std::string path; // beneath the --fs-root directory
+        uint64_t size = 0;
+        uint64_t mtime_ns = 0;
+    };
+
+    struct Syscall
+    {
+        uint32_t result;
+        uint64_t payload;  // hash of write() data, 0 for other calls
+        bool mapped;       // `file` is valid
+        MappedFile file;
+        uint32_t outputs;  // guest memory writes that follow
+    };
+
+    // Throws std::runtime_error if the log cannot be opened, or
+    // (replay) was recorded from a different ELF.
+    ReplayLog(const std::string &path, Mode mode, const std::string &elf_path);
+    ~ReplayLog();
+
+    ReplayLog(const ReplayLog &) = delete;
+    ReplayLog &operator=(const ReplayLog &) = delete;
+
+    bool replaying() const
+    {
+        return mode == Mode::Replay;
+    }
+
+    // 64-bit FNV-1a, continuing from `h`.
+    static uint64_t hash(const uint8_t *data, size_t len, uint64_t h = FNV_OFFSET);
+    static constexpr uint64_t FNV_OFFSET = 1469598103934665603ull;
+
+    // Record mode. Throw std::runtime_error if the log cannot be
+    // written. put_syscall() returns where `file`'s size and mtime
+    // were logged, for update_mapped().
+    uint64_t put_syscall(uint32_t nr, uint32_t result, uint64_t payload,
+                         const MappedFile *file, uint32_t outputs);
+    void put_output(uint32_t addr, const uint8_t *data, uint32_t len);
+    void update_mapped(uint64_t at, uint64_t size, uint64_t mtime_ns);
+    void flush(); // no-op in replay mode
+
+    // Replay mode. Throw std::runtime_error on divergence or a
+    // truncated log.
+    Syscall next_syscall(uint32_t nr);
+    uint32_t next_output(std::vector<uint8_t> &data);
+
+    // Index of the last record read or written, for messages.
+    uint64_t position() const
+    {
+        return records ? records - 1 : 0;
+    }
+
+    // HostClock::Tap: log or substitute guest time.
+    uint64_t time(uint64_t now) override;
+
+    // CounterTap: log or substitute cycle / hpmcounter reads.
+    uint32_t counter(uint32_t csr, uint32_t value) override;
+
+  private:
+    static constexpr uint8_t VERSION = 3;
+    static constexpr size_t OUT_SIZE = 1 << 16;
+
+    Mode mode;
+    FILE *file = nullptr; // replay
+    uint64_t last_time = 0;
+    uint64_t records = 0;
+
+    // Record: written with write(2), so a signal handler can
+    // flush what is buffered.
+    int out_fd = -1;
+    uint8_t out[OUT_SIZE];
+    volatile size_t out_len = 0;
+    volatile bool flushing = false;
+    uint64_t written = 0; // bytes already in the file
+
+    static void on_signal(int sig);
+
+    void put(const void *data, size_t len);
+    void put_u64(uint64_t v);
+    void put_fixed64(uint64_t v);
+    uint64_t get_u64();
+    uint64_t get_fixed64();
+    uint8_t get_tag(char expected, const char *what);
+};
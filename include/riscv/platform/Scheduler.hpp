@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "riscv/platform/HostClock.hpp"
+
+// ============================================================
+// GuestScheduler
+//
+// Runs many independent guests of the same ELF on one host
+// thread. Each guest is a CpuCore with its own address space
+// and its stdio bound to a non-blocking host descriptor
+// (typically a Unix socket connection).
+//
+// Guests are cooperative tasks:
+//   - a runnable guest executes at most `quantum` instructions
+//     before the next guest gets the CPU
+//   - a read/write that would block suspends the guest with its
+//     PC still on the ECALL (see SyscallStatus::Blocked)
+//   - epoll wakes the guest when its descriptor becomes ready,
+//     and the ECALL is simply executed again
+//
+// Latency is bounded by (runnable guests x quantum) instructions.
+//
+// A guest that exits with UART output its client has not taken
+// yet is parked as draining: its socket waits for EPOLLOUT like
+// any blocked write, and is closed once the output is written or
+// DRAIN_TIMEOUT_US passes. No session ever waits in place.
+//
+// A connection whose guest cannot be loaded is closed on its own.
+// One descriptor is held in reserve so that a connection accepted
+// with the last free descriptor can still open the ELF. When the
+// process runs out of descriptors the listener is paused until a
+// guest exits or a short back-off passes, rather than being
+// polled in a loop.
+// ============================================================
+
+struct GuestSession;
+struct Metrics;
+class MetricsExporter;
+
+class GuestScheduler
+{
+  public:
+    GuestScheduler(const std::string &elf_path, uint64_t quantum);
+    ~GuestScheduler();
+
+    GuestScheduler(const GuestScheduler &) = delete;
+    GuestScheduler &operator=(const GuestScheduler &) = delete;
+
+    // Start a guest on the given descriptors. Descriptors are
+    // switched to non-blocking mode; if owns_fds is set they are
+    // closed when the guest exits.
+    void spawn(int in_fd, int out_fd, bool owns_fds);
+
+    // Accept connections on a Unix socket; each connection
+    // becomes a fresh guest. The listener stays open until the
+    // scheduler is destroyed.
+    void listen_unix(const std::string &path);
+
+    // Sandbox root for guest file syscalls (see SyscallHandler).
+    void set_fs_root(int dirfd)
+    {
+        root_fd = dirfd;
+    }
+
+    // Count hpmcounter events in every guest (--hpm).
+    void set_hpm(bool on)
+    {
+        hpm = on;
+    }
+
+    // Aggregate trap/syscall counters of all guests into `m` and
+    // sample them through `exporter` between quanta. Both may be
+    // null. Guests run on the functional core, so per-instruction
+    // counters are not collected in this mode.
+    void set_metrics(Metrics *m, MetricsExporter *exporter)
+    {
+        metrics = m;
+        stats = exporter;
+    }
+
+    // Run until no guest is alive and no listener is open.
+    void run();
+
+    uint64_t get_inst_count() const
+    {
+        return retired;
+    }
+
+  private:
+    std::string elf;
+    uint64_t quantum;
+    uint64_t retired = 0;
+
+    int epoll_fd = -1;
+    int listen_fd = -1;
+    int root_fd = -1;
+    int spare_fd = -1; // released while a guest's ELF is loaded
+    bool hpm = false;
+    std::string listen_path;
+
+    // Listener paused on EMFILE/ENFILE until this time (us).
+    static constexpr uint64_t ACCEPT_BACKOFF_US = 100000;
+    HostClock clock;
+    bool accept_paused = false;
+    uint64_t accept_resume_us = 0;
+
+    Metrics *metrics = nullptr;
+    MetricsExporter *stats = nullptr;
+
+    size_t live = 0;
+    std::deque<GuestSession *> runnable;
+
+    // Exited guests still writing their last UART output.
+    static constexpr uint64_t DRAIN_TIMEOUT_US = 1000000;
+    std::vector<GuestSession *> draining;
+
+    void accept_clients();
+    void pause_accept();
+    void resume_accept();
+    int timeout_ms() const;
+    void run_quantum(GuestSession *g);
+    void wait_for(GuestSession *g);
+    void finish(GuestSession *g);
+    void drain(GuestSession *g);
+    void expire_drains();
+    void close_session(GuestSession *g);
+};
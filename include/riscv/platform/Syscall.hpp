@@ -1,6 +1,15 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "riscv/core/Metrics.hpp"
+#include "riscv/platform/ReplayLog.hpp"
 
 // ============================================================
 // SyscallHandler
@@ -12,8 +21,38 @@
 //
 // It provides enough functionality to support newlib:
 //   heap, I/O, and process exit.
+//
+// Guest file descriptors map to host descriptors. 0/1/2 are
+// bound to the host stdio pair (bind_stdio); further files can be
+// opened below a sandbox root directory (set_fs_root). Data moves
+// directly between host buffers and guest RAM, and file-backed
+// mmap() overlays host pages onto the guest address space.
+//
+// A guest buffer or path that faults fails the syscall with
+// -EFAULT, as on Linux; the Trap never leaves handle().
+//
+// In cooperative mode the stdio descriptors are expected to be
+// non-blocking: a read or write that would block returns
+// SyscallStatus::Blocked instead of stalling the host thread,
+// and the caller re-executes the ECALL once the fd is ready.
+//
+// With a ReplayLog attached, every syscall is recorded, or in
+// replay mode served from the log without touching host files.
+// Guest writes to stdout/stderr are still shown during replay.
+// The one exception is a file-backed mmap(): replay maps the file
+// again (privately, beneath the sandbox root), so the log holds
+// its identity rather than its contents. Files the guest could
+// change under the mapping (open for writing, or mapped shared
+// and writable) are logged by contents instead.
 // ============================================================
 
+enum class SyscallStatus
+{
+    Continue, // syscall completed, resume after ECALL
+    Exit,     // guest requested exit
+    Blocked   // would block; re-execute ECALL when wait_fd() is ready
+};
+
 template <typename State, typename Memory>
 class SyscallHandler
 {
@@ -21,14 +60,141 @@ class SyscallHandler
     explicit SyscallHandler(Memory &mem)
         : memory(mem), program_break(0), mmap_top(0)
     {
+        bind_stdio(0, 1, false);
     }
 
-    bool handle(State &state);
+    ~SyscallHandler();
+
+    SyscallHandler(const SyscallHandler &) = delete;
+    SyscallHandler &operator=(const SyscallHandler &) = delete;
+
+    SyscallStatus handle(State &state);
+
+    // Count calls, bytes and host time into `m` (nullptr disables).
+    void set_metrics(Metrics *m)
+    {
+        metrics = m;
+    }
+
+    // Record to / replay from `log` (nullptr disables). Not for
+    // cooperative I/O: a blocked syscall has no single result.
+    void set_replay(ReplayLog *log)
+    {
+        replay = log;
+    }
+
+    // Bind guest stdin / stdout+stderr to host descriptors.
+    void bind_stdio(int in, int out, bool cooperative_io);
+
+    // Directory that guest paths are resolved beneath.
+    // -1 (default) disables file access.
+    void set_fs_root(int dirfd)
+    {
+        root_fd = dirfd;
+    }
+
+    // Valid after handle() returned SyscallStatus::Blocked.
+    int wait_fd() const
+    {
+        return blocked_fd;
+    }
+    bool wait_for_write() const
+    {
+        return blocked_on_write;
+    }
 
   private:
+    // A guest descriptor slot.
+    struct GuestFd
+    {
+        int host = -1;
+        bool owned = false; // close the host fd with the guest fd
+        std::string path;   // beneath root_fd, if opened by openat()
+    };
+
+    // Host pages overlaid onto the guest by a file-backed mmap().
+    struct HostMapping
+    {
+        uint8_t *host;
+        size_t length;
+        dev_t dev = 0; // the file mapped, if any
+        ino_t ino = 0;
+        uint64_t offset = 0;
+    };
+
     Memory &memory;
     uint32_t program_break; // current end of heap (brk)
     uint32_t mmap_top;
+
+    std::vector<GuestFd> fds;
+    std::map<uint32_t, HostMapping> mappings; // by guest address
+    int root_fd = -1;
+    bool cooperative = false;
+
+    int blocked_fd = -1;
+    bool blocked_on_write = false;
+
+    Metrics *metrics = nullptr;
+
+    // Record/replay. While a syscall is being replayed, host
+    // calls are skipped and `replay_result` is used instead.
+    struct GuestOutput
+    {
+        uint32_t addr;
+        uint32_t len;
+    };
+
+    ReplayLog *replay = nullptr;
+    bool replaying = false;
+    uint32_t replay_result = 0;
+    const ReplayLog::MappedFile *replay_file = nullptr;
+    std::vector<GuestOutput> outputs; // recorded after the syscall
+    ReplayLog::MappedFile mapped;     // recorded file-backed mmap()
+    bool mapped_file = false;
+    int mapped_fd = -1; // host fd of `mapped`
+
+    // A file logged by identity. Its fd is kept open so changes
+    // the guest makes later are caught and re-logged.
+    struct LoggedFile
+    {
+        int fd;
+        dev_t dev;
+        ino_t ino;
+        uint64_t size;
+        uint64_t mtime_ns;
+        std::vector<uint64_t> records; // ReplayLog::update_mapped() positions
+    };
+    std::vector<LoggedFile> logged_files;
+
+    SyscallStatus logged(State &state);
+    SyscallStatus checked(State &state);
+    SyscallStatus dispatch(State &state);
+    uint64_t payload_hash(const State &state);
+    void note_output(uint32_t addr, uint32_t len);
+    void note_file_write(int fd, int64_t offset, size_t len);
+    int32_t replay_map(uint32_t addr, uint32_t size, uint64_t offset);
+    void log_mapped_file(int fd, uint64_t at);
+    void relog_changed_files();
+
+    static int open_beneath(int base, const std::string &rel, int flags, uint32_t mode);
+    int host_fd(uint32_t guest_fd) const;
+    int alloc_fd(int host, const std::string &path);
+
+    SyscallStatus block_on(int fd, bool write);
+    ssize_t host_io(int fd, uint8_t *buf, size_t len, bool write, int64_t offset);
+    SyscallStatus transfer(State &state, uint32_t guest_fd, uint32_t addr,
+                           uint32_t len, bool write, int64_t offset);
+
+    int32_t sys_openat(uint32_t dirfd, uint32_t path, uint32_t flags, uint32_t mode);
+    int32_t sys_close(uint32_t guest_fd);
+    int32_t sys_lseek(uint32_t guest_fd, int32_t offset, uint32_t whence);
+    int32_t sys_fstat(uint32_t guest_fd, uint32_t addr);
+    int32_t map_file(uint32_t addr, uint32_t size, uint32_t prot,
+                     uint32_t flags, uint32_t guest_fd, uint64_t offset);
+    int32_t map_host_file(int fd, const struct stat &st, uint32_t addr,
+                          uint32_t size, uint64_t offset, bool shared);
+    bool open_for_write(const struct stat &st) const;
+    void lazy_init(State &state);
 };
 
 #include "Syscall.tpp"
@@ -1,6 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef SYS_openat2
+#include <linux/openat2.h>
+#endif
+
+#include "riscv/core/Trap.hpp"
 
 extern uint32_t g_image_end;
 
@@ -9,85 +29,399 @@ extern uint32_t g_image_end;
 // - mmap() allocates anonymous memory above the heap
 // - stack grows downward and is protected from collision
 
+// Guest ABI constants (asm-generic, as seen by RV32 code).
+// Prefixed because the host <fcntl.h> names are macros.
+constexpr int32_t GUEST_AT_FDCWD = -100;
+
+constexpr uint32_t GUEST_O_ACCMODE = 0003;
+constexpr uint32_t GUEST_O_CREAT = 0100;
+constexpr uint32_t GUEST_O_EXCL = 0200;
+constexpr uint32_t GUEST_O_TRUNC = 01000;
+constexpr uint32_t GUEST_O_APPEND = 02000;
+constexpr uint32_t GUEST_O_DIRECTORY = 0200000;
+
+constexpr uint32_t GUEST_MAP_SHARED = 0x01;
+constexpr uint32_t GUEST_MAP_ANONYMOUS = 0x20;
+constexpr uint32_t GUEST_PROT_WRITE = 0x2;
+
+constexpr uint32_t GUEST_PAGE_SIZE = 4096;
+constexpr uint32_t GUEST_PATH_MAX = 4096;
+
 template <typename State, typename Memory>
-bool SyscallHandler<State, Memory>::handle(State &state)
+SyscallHandler<State, Memory>::~SyscallHandler()
 {
-    uint32_t syscall = state.reg(17); // a7
+    for (auto &m : mappings)
+        ::munmap(m.second.host, m.second.length);
 
-    uint32_t a0 = state.reg(10);
-    uint32_t a1 = state.reg(11);
-    uint32_t a2 = state.reg(12);
+    for (auto &f : fds)
+    {
+        if (f.owned)
+            ::close(f.host);
+    }
 
-    switch (syscall)
+    for (auto &f : logged_files)
+        ::close(f.fd);
+}
+
+template <typename State, typename Memory>
+void SyscallHandler<State, Memory>::bind_stdio(int in, int out, bool cooperative_io)
+{
+    if (fds.size() < 3)
+        fds.resize(3);
+
+    // Guest stderr shares the stdout descriptor.
+    fds[0] = {in, false, {}};
+    fds[1] = {out, false, {}};
+    fds[2] = {out, false, {}};
+    cooperative = cooperative_io;
+}
+
+template <typename State, typename Memory>
+SyscallStatus SyscallHandler<State, Memory>::handle(State &state)
+{
+    if (!metrics)
+        return logged(state);
+
+    const uint32_t nr = state.reg(17);
+    const uint64_t bytes_before = metrics->bytes_in + metrics->bytes_out;
+
+    timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SyscallStatus status = logged(state);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    uint64_t ns = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ull +
+                  (end.tv_nsec - start.tv_nsec);
+
+    Metrics::SyscallCounters &c = metrics->syscalls[nr];
+    c.calls++;
+    c.blocked += (status == SyscallStatus::Blocked);
+    c.bytes += metrics->bytes_in + metrics->bytes_out - bytes_before;
+    c.host_ns += ns;
+    metrics->syscall_ns += ns;
+
+    return status;
+}
+
+// ------------------------------------------------------------
+// Record / replay
+// ------------------------------------------------------------
+
+template <typename State, typename Memory>
+SyscallStatus SyscallHandler<State, Memory>::logged(State &state)
+{
+    if (!replay)
+        return checked(state);
+
+    const uint32_t nr = state.reg(17);
+
+    if (replay->replaying())
     {
-    case 63: // read(fd, buf, len)
+        ReplayLog::Syscall rec = replay->next_syscall(nr);
+
+        if (payload_hash(state) != rec.payload)
+            throw std::runtime_error("replay: guest diverged at record " +
+                                     std::to_string(replay->position()) + ": syscall " +
+                                     std::to_string(nr) + " writes different data");
+
+        replaying = true;
+        replay_result = rec.result;
+        replay_file = rec.mapped ? &rec.file : nullptr;
+        SyscallStatus status = checked(state);
+        replaying = false;
+        replay_file = nullptr;
+
+        std::vector<uint8_t> data;
+        for (uint32_t i = 0; i < rec.outputs; i++)
+        {
+            uint32_t addr = replay->next_output(data);
+            if (uint8_t *p = memory.host_range(addr, data.size()))
+                std::memcpy(p, data.data(), data.size());
+            else
+                for (size_t j = 0; j < data.size(); j++)
+                    memory.write_byte(addr + j, data[j]);
+        }
+
+        // Deterministic syscalls really ran: check they agree.
+        if (state.reg(10) != rec.result)
+            throw std::runtime_error("replay: syscall " + std::to_string(nr) +
+                                     " returned " + std::to_string(state.reg(10)) +
+                                     ", log has " + std::to_string(rec.result));
+        return status;
+    }
+
+    const uint64_t payload = payload_hash(state);
+    outputs.clear();
+    mapped_file = false;
+    SyscallStatus status = checked(state);
+
+    const uint64_t at = replay->put_syscall(nr, state.reg(10), payload,
+                                            mapped_file ? &mapped : nullptr, outputs.size());
+    for (const GuestOutput &o : outputs)
     {
-        if (a0 == 0) // stdin
+        if (const uint8_t *p = memory.host_range(o.addr, o.len))
         {
-            int c = std::cin.get();
-            if (c == EOF)
-            {
-                state.set_reg(10, 0);
-                return true;
-            }
+            replay->put_output(o.addr, p, o.len);
+            continue;
+        }
+        std::vector<uint8_t> data(o.len);
+        for (uint32_t j = 0; j < o.len; j++)
+            data[j] = memory.read_byte(o.addr + j);
+        replay->put_output(o.addr, data.data(), o.len);
+    }
 
-            memory.write_byte(a1, (uint8_t)c);
-            uint32_t i = 1;
+    if (mapped_file)
+        log_mapped_file(mapped_fd, at);
+    relog_changed_files();
+    replay->flush();
+    return status;
+}
 
-            while (i < a2 && std::cin.rdbuf()->in_avail() > 0)
-            {
-                c = std::cin.get();
-                if (c == EOF)
-                    break;
-                memory.write_byte(a1 + i, (uint8_t)c);
-                i++;
-            }
+// Remember a file just logged by identity (`at` from put_syscall).
+template <typename State, typename Memory>
+void SyscallHandler<State, Memory>::log_mapped_file(int fd, uint64_t at)
+{
+    struct stat st;
+    if (::fstat(fd, &st) < 0)
+        throw std::runtime_error("record: cannot stat mapped file " + mapped.path);
 
-            state.set_reg(10, i);
-            return true;
+    for (LoggedFile &f : logged_files)
+    {
+        if (f.dev == st.st_dev && f.ino == st.st_ino)
+        {
+            f.records.push_back(at);
+            return;
         }
+    }
 
-        state.set_reg(10, static_cast<uint32_t>(-1));
-        return true;
+    int copy = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0)
+        throw std::runtime_error("record: cannot keep mapped file " + mapped.path + " open");
+    logged_files.push_back({copy, st.st_dev, st.st_ino, mapped.size, mapped.mtime_ns, {at}});
+}
+
+// Replay finds mapped files as the recording left them, so when
+// the guest changes one it had not opened for writing when it
+// mapped it, every record of it is updated to match.
+template <typename State, typename Memory>
+void SyscallHandler<State, Memory>::relog_changed_files()
+{
+    for (LoggedFile &f : logged_files)
+    {
+        struct stat st;
+        if (::fstat(f.fd, &st) < 0)
+            continue;
+
+        const uint64_t mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+        if ((uint64_t)st.st_size == f.size && mtime_ns == f.mtime_ns)
+            continue;
+
+        f.size = st.st_size;
+        f.mtime_ns = mtime_ns;
+        for (uint64_t at : f.records)
+            replay->update_mapped(at, f.size, f.mtime_ns);
     }
+}
 
-    case 64: // write(fd, buf, len)
+// Hash of the bytes a write()/pwrite() hands to the host, so a
+// replay that would print or store something else is caught. The
+// hash stops at the first unreadable byte, as the write would.
+template <typename State, typename Memory>
+uint64_t SyscallHandler<State, Memory>::payload_hash(const State &state)
+{
+    const uint32_t nr = state.reg(17);
+    if (nr != 64 && nr != 68)
+        return 0;
+
+    const uint32_t addr = state.reg(11);
+    const uint32_t len = state.reg(12);
+    if (const uint8_t *p = memory.host_range(addr, len))
+        return ReplayLog::hash(p, len);
+
+    uint64_t h = ReplayLog::FNV_OFFSET;
+    try
     {
-        if (a0 == 1 || a0 == 2)
+        for (uint32_t i = 0; i < len; i++)
         {
-            for (uint32_t i = 0; i < a2; ++i)
-                std::cout << (char)memory.read_byte(a1 + i);
-            std::cout.flush();
-            state.set_reg(10, a2);
-            return true;
+            uint8_t b = memory.read_byte(addr + i);
+            h = ReplayLog::hash(&b, 1, h);
         }
-        state.set_reg(10, static_cast<uint32_t>(-1));
-        return true;
     }
+    catch (const Trap &)
+    {
+    }
+    return h;
+}
 
-    case 80:  // newlib brk
-    case 214: // Linux brk
+// Guest memory filled from the host by the current syscall.
+template <typename State, typename Memory>
+void SyscallHandler<State, Memory>::note_output(uint32_t addr, uint32_t len)
+{
+    if (replay && !replaying && len)
+        outputs.push_back({addr, len});
+}
+
+// A write to a mapped file changes the guest's view of it (shared
+// mappings, and private pages not yet copied on write). Replay
+// skips the write, so the bytes it changed are logged as outputs.
+template <typename State, typename Memory>
+void SyscallHandler<State, Memory>::note_file_write(int fd, int64_t offset, size_t len)
+{
+    if (!replay || replaying || mappings.empty())
+        return;
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return;
+
+    const uint64_t start = offset >= 0 ? (uint64_t)offset : (uint64_t)::lseek(fd, 0, SEEK_CUR) - len;
+    for (const auto &m : mappings)
     {
-        uint32_t new_brk = a0;
-        uint32_t sp = state.reg(2);
+        const HostMapping &h = m.second;
+        if (h.dev != st.st_dev || h.ino != st.st_ino)
+            continue;
+
+        const uint64_t lo = std::max<uint64_t>(start, h.offset);
+        const uint64_t hi = std::min<uint64_t>(start + len, h.offset + h.length);
+        if (lo < hi)
+            note_output(m.first + (uint32_t)(lo - h.offset), (uint32_t)(hi - lo));
+    }
+}
 
-        // Lazy init
-        if (program_break == 0)
+// Stand-in for map_file(). A file recorded by identity is opened
+// beneath the root as sys_openat() would and mapped again,
+// privately, once its size and mtime are confirmed; otherwise an
+// anonymous overlay receives the logged contents.
+template <typename State, typename Memory>
+int32_t SyscallHandler<State, Memory>::replay_map(uint32_t addr, uint32_t size, uint64_t offset)
+{
+    if (replay_result >= (uint32_t)-4095)
+        return (int32_t)replay_result;
+
+    if (replay_file)
+    {
+        const std::string &path = replay_file->path;
+        if (root_fd < 0)
+            throw std::runtime_error("replay: mmap of " + path + " needs --fs-root");
+
+        int fd = open_beneath(root_fd, path, O_RDONLY | O_CLOEXEC, 0);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) < 0)
         {
-            program_break = g_image_end;
-            mmap_top = sp - 0x10000;
+            if (fd >= 0)
+                ::close(fd);
+            throw std::runtime_error("replay: cannot open mapped file " + path);
         }
 
+        const uint64_t mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+        if ((uint64_t)st.st_size != replay_file->size || mtime_ns != replay_file->mtime_ns)
+        {
+            ::close(fd);
+            throw std::runtime_error("replay: mapped file " + path + " changed since it was recorded");
+        }
+
+        int32_t err = map_host_file(fd, st, addr, size, offset, false);
+        ::close(fd);
+        if (err < 0)
+            throw std::runtime_error("replay: cannot map " + path);
+        return 0;
+    }
+
+    void *base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return -ENOMEM;
+
+    memory.map_host(addr, size, static_cast<uint8_t *>(base));
+    mappings[addr] = {static_cast<uint8_t *>(base), size};
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Dispatch
+// ------------------------------------------------------------
+
+// A fault on a guest pointer is the guest's error, not the
+// host's: report it in a0 and let the guest carry on. Letting
+// the Trap escape would unwind out of CpuCore::step()'s own
+// handler and take down every guest of a --serve process.
+template <typename State, typename Memory>
+SyscallStatus SyscallHandler<State, Memory>::checked(State &state)
+{
+    try
+    {
+        return dispatch(state);
+    }
+    catch (const Trap &)
+    {
+        state.set_reg(10, (uint32_t)-EFAULT);
+        return SyscallStatus::Continue;
+    }
+}
+
+template <typename State, typename Memory>
+SyscallStatus SyscallHandler<State, Memory>::dispatch(State &state)
+{
+    uint32_t syscall = state.reg(17); // a7
+
+    uint32_t a0 = state.reg(10);
+    uint32_t a1 = state.reg(11);
+    uint32_t a2 = state.reg(12);
+    uint32_t a3 = state.reg(13);
+    uint32_t a4 = state.reg(14);
+    uint32_t a5 = state.reg(15);
+
+    blocked_fd = -1;
+
+    // Keep device (UART) output ordered with syscall I/O.
+    memory.flush_devices();
+
+    switch (syscall)
+    {
+    case 56: // openat(dirfd, path, flags, mode)
+        state.set_reg(10, replaying ? replay_result : sys_openat(a0, a1, a2, a3));
+        return SyscallStatus::Continue;
+
+    case 57: // close(fd)
+        state.set_reg(10, replaying ? replay_result : sys_close(a0));
+        return SyscallStatus::Continue;
+
+    case 62: // lseek(fd, offset, whence)
+        state.set_reg(10, replaying ? replay_result : sys_lseek(a0, (int32_t)a1, a2));
+        return SyscallStatus::Continue;
+
+    case 63: // read(fd, buf, len)
+        return transfer(state, a0, a1, a2, false, -1);
+
+    case 64: // write(fd, buf, len)
+        return transfer(state, a0, a1, a2, true, -1);
+
+    case 67: // pread64(fd, buf, len, off_lo, off_hi)
+        return transfer(state, a0, a1, a2, false, (int64_t)(((uint64_t)a4 << 32) | a3));
+
+    case 68: // pwrite64(fd, buf, len, off_lo, off_hi)
+        return transfer(state, a0, a1, a2, true, (int64_t)(((uint64_t)a4 << 32) | a3));
+
+    case 80: // fstat(fd, statbuf)
+        state.set_reg(10, replaying ? replay_result : sys_fstat(a0, a1));
+        return SyscallStatus::Continue;
+
+    case 214: // brk
+    {
+        uint32_t new_brk = a0;
+
+        lazy_init(state);
+
         if (new_brk == 0)
         {
             state.set_reg(10, program_break);
-            return true;
+            return SyscallStatus::Continue;
         }
 
         if (new_brk >= mmap_top - 4096 || new_brk < program_break)
         {
             state.set_reg(10, (uint32_t)-1);
-            return true;
+            return SyscallStatus::Continue;
         }
 
         if (new_brk > program_break)
@@ -95,54 +429,582 @@ bool SyscallHandler<State, Memory>::handle(State &state)
 
         program_break = new_brk;
         state.set_reg(10, program_break);
-        return true;
+        return SyscallStatus::Continue;
     }
 
-    case 222: // mmap
+    case 222: // mmap(addr, len, prot, flags, fd, pgoff)
     {
         uint32_t size = (a1 + 4095) & ~4095;
-        uint32_t sp = state.reg(2);
 
-        if (program_break == 0)
-        {
-            program_break = g_image_end;
-            mmap_top = sp - 0x10000;
-        }
+        lazy_init(state);
 
         uint32_t addr = mmap_top - size;
 
         if (addr <= program_break + 4096)
         {
             state.set_reg(10, (uint32_t)-1);
-            return true;
+            return SyscallStatus::Continue;
+        }
+
+        if (!(a3 & GUEST_MAP_ANONYMOUS) && (int32_t)a4 >= 0)
+        {
+            // RV32 mmap takes the file offset in pages (mmap2).
+            const uint64_t offset = (uint64_t)a5 * GUEST_PAGE_SIZE;
+            int32_t err = replaying ? replay_map(addr, size, offset)
+                                    : map_file(addr, size, a2, a3, a4, offset);
+            if (err < 0)
+            {
+                state.set_reg(10, err);
+                return SyscallStatus::Continue;
+            }
         }
+        else
+            memory.memset(addr, 0, size);
 
         mmap_top = addr;
-        memory.memset(addr, 0, size);
         state.set_reg(10, addr);
-        return true;
+        return SyscallStatus::Continue;
     }
 
     case 215: // munmap
     {
         uint32_t addr = a0;
         uint32_t size = (a1 + 4095) & ~4095;
+        const uint64_t end = (uint64_t)addr + size;
+
+        // File overlays are unmapped whole; splitting one is not
+        // supported, so a range that cuts through one is refused
+        // before anything is released.
+        auto first = mappings.lower_bound(addr);
+        if (first != mappings.begin() && std::prev(first)->first + std::prev(first)->second.length > addr)
+            --first;
+
+        auto last = first;
+        for (; last != mappings.end() && last->first < end; ++last)
+        {
+            if (last->first < addr || last->first + last->second.length > end)
+            {
+                state.set_reg(10, (uint32_t)-EINVAL);
+                return SyscallStatus::Continue;
+            }
+        }
+
+        for (auto it = first; it != last; ++it)
+        {
+            memory.unmap_host(it->first);
+            ::munmap(it->second.host, it->second.length);
+        }
+        mappings.erase(first, last);
 
         if (addr == mmap_top)
             mmap_top += size;
 
         state.set_reg(10, 0);
-        return true;
+        return SyscallStatus::Continue;
     }
 
     case 93: // exit
     {
-        std::cout << "\n[program exited with code " << a0 << "]\n";
-        return false;
+        std::string msg = "\n[program exited with code " + std::to_string(a0) + "]\n";
+        host_io(fds[1].host, (uint8_t *)&msg[0], msg.size(), true, -1);
+        return SyscallStatus::Exit;
     }
 
     default:
         std::cerr << "Unknown syscall " << syscall << "\n";
-        return false;
+        return SyscallStatus::Exit;
+    }
+}
+
+// ------------------------------------------------------------
+// Process layout
+// ------------------------------------------------------------
+
+template <typename State, typename Memory>
+void SyscallHandler<State, Memory>::lazy_init(State &state)
+{
+    if (program_break == 0)
+    {
+        program_break = g_image_end;
+        mmap_top = state.reg(2) - 0x10000;
+    }
+}
+
+// ------------------------------------------------------------
+// Descriptor table
+// ------------------------------------------------------------
+
+template <typename State, typename Memory>
+int SyscallHandler<State, Memory>::host_fd(uint32_t guest_fd) const
+{
+    return guest_fd < fds.size() ? fds[guest_fd].host : -1;
+}
+
+// Lowest free guest descriptor, as POSIX requires.
+template <typename State, typename Memory>
+int SyscallHandler<State, Memory>::alloc_fd(int host, const std::string &path)
+{
+    for (size_t i = 0; i < fds.size(); i++)
+    {
+        if (fds[i].host < 0)
+        {
+            fds[i] = {host, true, path};
+            return (int)i;
+        }
+    }
+    fds.push_back({host, true, path});
+    return (int)fds.size() - 1;
+}
+
+// Record which descriptor the guest is waiting on.
+// PC is left on the ECALL, so the syscall is simply restarted.
+template <typename State, typename Memory>
+SyscallStatus SyscallHandler<State, Memory>::block_on(int fd, bool write)
+{
+    blocked_fd = fd;
+    blocked_on_write = write;
+    return SyscallStatus::Blocked;
+}
+
+// ------------------------------------------------------------
+// Data transfer
+// ------------------------------------------------------------
+
+// One host read/write (pread/pwrite if offset >= 0).
+// Blocking mode waits for the fd and writes everything;
+// cooperative mode returns -EAGAIN or a short count instead.
+// Returns bytes transferred or -errno.
+template <typename State, typename Memory>
+ssize_t SyscallHandler<State, Memory>::host_io(int fd, uint8_t *buf, size_t len,
+                                               bool write, int64_t offset)
+{
+    size_t off = 0;
+
+    while (off < len || len == 0)
+    {
+        ssize_t n;
+        if (offset >= 0)
+            n = write ? ::pwrite(fd, buf + off, len - off, offset + off)
+                      : ::pread(fd, buf + off, len - off, offset + off);
+        else
+            n = write ? ::write(fd, buf + off, len - off)
+                      : ::read(fd, buf + off, len - off);
+
+        if (n >= 0)
+        {
+            off += n;
+            if (!write || n == 0)
+                break; // reads return what is available
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return off ? (ssize_t)off : -errno;
+        if (cooperative)
+            return off ? (ssize_t)off : -EAGAIN;
+
+        pollfd p{fd, (short)(write ? POLLOUT : POLLIN), 0};
+        ::poll(&p, 1, -1);
+    }
+    return off;
+}
+
+// read/write/pread/pwrite between a guest buffer and a host fd.
+// Contiguous RAM is handed to the host directly; anything else
+// (MMIO, unmapped) goes through a bounce buffer of ordinary guest
+// accesses, so devices see the bytes. As on Linux, a fault ends
+// the transfer short and the call returns the bytes moved so far;
+// only a fault on the first byte fails it with -EFAULT (see
+// checked()).
+template <typename State, typename Memory>
+SyscallStatus SyscallHandler<State, Memory>::transfer(State &state, uint32_t guest_fd,
+                                                      uint32_t addr, uint32_t len,
+                                                      bool write, int64_t offset)
+{
+    // Replay: input comes from the log; output to the terminal is
+    // still performed so the run can be watched.
+    if (replaying && !(write && guest_fd <= 2))
+    {
+        state.set_reg(10, replay_result);
+        return SyscallStatus::Continue;
+    }
+
+    int fd = host_fd(guest_fd);
+    if (fd < 0)
+    {
+        state.set_reg(10, (uint32_t)-EBADF);
+        return SyscallStatus::Continue;
+    }
+
+    ssize_t result;
+
+    if (uint8_t *p = memory.host_range(addr, len))
+    {
+        result = host_io(fd, p, len, write, offset);
+        if (!write && result > 0)
+            note_output(addr, (uint32_t)result);
+    }
+    else
+    {
+        uint8_t buf[4096];
+        uint32_t done = 0;
+        result = 0;
+
+        bool faulted = false;
+
+        while (done < len && !faulted)
+        {
+            size_t chunk = std::min<size_t>(len - done, sizeof(buf));
+
+            if (write)
+            {
+                // Send the readable prefix of a chunk that faults.
+                size_t i = 0;
+                try
+                {
+                    for (; i < chunk; ++i)
+                        buf[i] = memory.read_byte(addr + done + i);
+                }
+                catch (const Trap &)
+                {
+                    if (done + i == 0)
+                        throw;
+                    chunk = i;
+                    faulted = true;
+                }
+            }
+
+            ssize_t n = host_io(fd, buf, chunk, write,
+                                offset >= 0 ? offset + done : -1);
+            if (n <= 0)
+            {
+                if (done == 0)
+                    result = n;
+                break;
+            }
+
+            if (!write)
+            {
+                // Log what reached the guest even if a later byte
+                // faults, so a replay leaves memory the same.
+                ssize_t i = 0;
+                try
+                {
+                    for (; i < n; ++i)
+                        memory.write_byte(addr + done + i, buf[i]);
+                }
+                catch (const Trap &)
+                {
+                    note_output(addr + done, (uint32_t)i);
+                    if (done + i == 0)
+                        throw;
+                    n = i;
+                    faulted = true;
+                }
+                if (!faulted)
+                    note_output(addr + done, (uint32_t)n);
+            }
+
+            done += n;
+            result = done;
+            if ((size_t)n < chunk)
+                break;
+        }
+    }
+
+    if (result == -EAGAIN)
+        return block_on(fd, write);
+
+    if (write && result > 0)
+        note_file_write(fd, offset, (size_t)result);
+
+    if (metrics && result > 0)
+        (write ? metrics->bytes_out : metrics->bytes_in) += result;
+
+    if (replaying)
+        result = (int32_t)replay_result;
+
+    state.set_reg(10, (uint32_t)result);
+    return SyscallStatus::Continue;
+}
+
+// ------------------------------------------------------------
+// Files
+// ------------------------------------------------------------
+
+// Resolve a guest path strictly beneath the sandbox root.
+// Paths are normalised lexically (".." may not escape the root);
+// where the host supports openat2(), the kernel additionally
+// refuses symlinks that lead outside it.
+template <typename State, typename Memory>
+int32_t SyscallHandler<State, Memory>::sys_openat(uint32_t dirfd, uint32_t path_addr,
+                                                  uint32_t flags, uint32_t mode)
+{
+    if (root_fd < 0)
+        return -EACCES;
+
+    // `prefix` is where `base` sits beneath the root.
+    int base = root_fd;
+    std::string prefix = ".";
+    if ((int32_t)dirfd != GUEST_AT_FDCWD)
+    {
+        base = host_fd(dirfd);
+        if (base < 0)
+            return -EBADF;
+        prefix = fds[dirfd].path;
+    }
+
+    std::string raw;
+    for (uint32_t i = 0;; i++)
+    {
+        if (i >= GUEST_PATH_MAX)
+            return -ENAMETOOLONG;
+        char c = (char)memory.read_byte(path_addr + i);
+        if (!c)
+            break;
+        raw += c;
+    }
+
+    // Absolute guest paths are relative to the root.
+    if (!raw.empty() && raw[0] == '/')
+    {
+        base = root_fd;
+        prefix = ".";
+    }
+
+    std::vector<std::string> parts;
+    size_t pos = 0;
+    while (pos <= raw.size())
+    {
+        size_t next = raw.find('/', pos);
+        if (next == std::string::npos)
+            next = raw.size();
+        std::string part = raw.substr(pos, next - pos);
+        pos = next + 1;
+
+        if (part.empty() || part == ".")
+            continue;
+        if (part == "..")
+        {
+            if (parts.empty())
+                return -EACCES;
+            parts.pop_back();
+            continue;
+        }
+        parts.push_back(part);
+    }
+
+    std::string rel = ".";
+    for (const auto &p : parts)
+        rel += "/" + p;
+
+    int host_flags = O_CLOEXEC;
+    switch (flags & GUEST_O_ACCMODE)
+    {
+    case 0:
+        host_flags |= O_RDONLY;
+        break;
+    case 1:
+        host_flags |= O_WRONLY;
+        break;
+    default:
+        host_flags |= O_RDWR;
+        break;
     }
+    if (flags & GUEST_O_CREAT)
+        host_flags |= O_CREAT;
+    if (flags & GUEST_O_EXCL)
+        host_flags |= O_EXCL;
+    if (flags & GUEST_O_TRUNC)
+        host_flags |= O_TRUNC;
+    if (flags & GUEST_O_APPEND)
+        host_flags |= O_APPEND;
+    if (flags & GUEST_O_DIRECTORY)
+        host_flags |= O_DIRECTORY;
+
+    int fd = open_beneath(base, rel, host_flags, mode);
+    if (fd < 0)
+        return -errno;
+
+    return alloc_fd(fd, prefix.empty() ? prefix : prefix + rel.substr(1));
+}
+
+// openat() of a normalised relative path, confined by the kernel
+// where the host supports openat2(). Returns -1 with errno set.
+template <typename State, typename Memory>
+int SyscallHandler<State, Memory>::open_beneath(int base, const std::string &rel,
+                                                int flags, uint32_t mode)
+{
+#ifdef SYS_openat2
+    open_how how{};
+    how.flags = flags;
+    how.mode = (flags & O_CREAT) ? (mode & 0777) : 0;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+    int fd = (int)::syscall(SYS_openat2, base, rel.c_str(), &how, sizeof(how));
+    if (fd >= 0 || errno != ENOSYS)
+        return fd;
+#endif
+    return ::openat(base, rel.c_str(), flags, mode & 0777);
+}
+
+template <typename State, typename Memory>
+int32_t SyscallHandler<State, Memory>::sys_close(uint32_t guest_fd)
+{
+    if (host_fd(guest_fd) < 0)
+        return -EBADF;
+
+    GuestFd &f = fds[guest_fd];
+    if (f.owned)
+        ::close(f.host);
+    f = GuestFd{};
+    return 0;
+}
+
+template <typename State, typename Memory>
+int32_t SyscallHandler<State, Memory>::sys_lseek(uint32_t guest_fd, int32_t offset, uint32_t whence)
+{
+    int fd = host_fd(guest_fd);
+    if (fd < 0)
+        return -EBADF;
+
+    off_t pos = ::lseek(fd, offset, (int)whence);
+    if (pos < 0)
+        return -errno;
+    if (pos > INT32_MAX)
+        return -EOVERFLOW;
+    return (int32_t)pos;
+}
+
+// Writes the RV32 Linux/newlib `struct kernel_stat` (128 bytes).
+template <typename State, typename Memory>
+int32_t SyscallHandler<State, Memory>::sys_fstat(uint32_t guest_fd, uint32_t addr)
+{
+    int fd = host_fd(guest_fd);
+    if (fd < 0)
+        return -EBADF;
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0)
+        return -errno;
+
+    uint8_t out[128] = {};
+    auto put32 = [&](size_t off, uint32_t v)
+    { std::memcpy(out + off, &v, 4); };
+    auto put64 = [&](size_t off, uint64_t v)
+    { std::memcpy(out + off, &v, 8); };
+
+    put64(0, st.st_dev);
+    put64(8, st.st_ino);
+    put32(16, st.st_mode);
+    put32(20, st.st_nlink);
+    put32(24, st.st_uid);
+    put32(28, st.st_gid);
+    put64(32, st.st_rdev);
+    put64(48, st.st_size);
+    put32(56, st.st_blksize);
+    put64(64, st.st_blocks);
+    put64(72, st.st_atim.tv_sec);
+    put32(80, st.st_atim.tv_nsec);
+    put64(88, st.st_mtim.tv_sec);
+    put32(96, st.st_mtim.tv_nsec);
+    put64(104, st.st_ctim.tv_sec);
+    put32(112, st.st_ctim.tv_nsec);
+
+    for (size_t i = 0; i < sizeof(out); i++)
+        memory.write_byte(addr + i, out[i]);
+    note_output(addr, sizeof(out));
+    return 0;
+}
+
+// Map [offset, offset+size) of a host file at guest `addr`
+// without copying. Pages past end-of-file are anonymous zero
+// pages so the guest never sees SIGBUS. Writable MAP_SHARED
+// mappings write through to the file; everything else is
+// copy-on-write.
+template <typename State, typename Memory>
+int32_t SyscallHandler<State, Memory>::map_file(uint32_t addr, uint32_t size, uint32_t prot,
+                                                uint32_t flags, uint32_t guest_fd, uint64_t offset)
+{
+    int fd = host_fd(guest_fd);
+    if (fd < 0)
+        return -EBADF;
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0)
+        return -errno;
+
+    bool shared = (flags & GUEST_MAP_SHARED) && (prot & GUEST_PROT_WRITE);
+    int32_t err = map_host_file(fd, st, addr, size, offset, shared);
+    if (err < 0 || !replay)
+        return err;
+
+    // Files beneath the root are logged by identity and mapped
+    // again on replay; anything else (e.g. stdin) by contents, as
+    // are files the guest can change under the mapping (open for
+    // writing, or mapped shared and writable).
+    const std::string &path = fds[guest_fd].path;
+    if (path.empty() || shared || open_for_write(st))
+    {
+        uint64_t file_bytes = (uint64_t)st.st_size > offset ? st.st_size - offset : 0;
+        note_output(addr, (uint32_t)std::min<uint64_t>(size, file_bytes));
+        return 0;
+    }
+
+    mapped.path = path;
+    mapped.size = st.st_size;
+    mapped.mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+    mapped_file = true;
+    mapped_fd = fd;
+    return 0;
+}
+
+// Whether any guest descriptor can write to the file `st`.
+template <typename State, typename Memory>
+bool SyscallHandler<State, Memory>::open_for_write(const struct stat &st) const
+{
+    for (const GuestFd &f : fds)
+    {
+        struct stat other;
+        if (f.host < 0 || f.path.empty() || ::fstat(f.host, &other) < 0 ||
+            other.st_dev != st.st_dev || other.st_ino != st.st_ino)
+            continue;
+        if ((::fcntl(f.host, F_GETFL) & O_ACCMODE) != O_RDONLY)
+            return true;
+    }
+    return false;
+}
+
+template <typename State, typename Memory>
+int32_t SyscallHandler<State, Memory>::map_host_file(int fd, const struct stat &st, uint32_t addr,
+                                                     uint32_t size, uint64_t offset, bool shared)
+{
+    long page = ::sysconf(_SC_PAGESIZE);
+    if (offset % page)
+        return -EINVAL;
+
+    void *base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return -ENOMEM;
+
+    uint64_t file_bytes = (uint64_t)st.st_size > offset ? st.st_size - offset : 0;
+    size_t file_len = (size_t)std::min<uint64_t>(size, (file_bytes + page - 1) & ~(uint64_t)(page - 1));
+
+    if (file_len)
+    {
+        void *p = ::mmap(base, file_len, PROT_READ | PROT_WRITE,
+                         (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED,
+                         fd, (off_t)offset);
+        if (p == MAP_FAILED)
+        {
+            int err = errno;
+            ::munmap(base, size);
+            return -err;
+        }
+    }
+
+    memory.map_host(addr, size, static_cast<uint8_t *>(base));
+    mappings[addr] = {static_cast<uint8_t *>(base), size, st.st_dev, st.st_ino, offset};
+    return 0;
 }
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <vector>
+#include <unistd.h>
+#include "riscv/memory/Device.hpp"
+
+// ============================================================
+// Uart
+//
+// Transmit side of a 16550-style UART.
+//
+//   +0  THR  write: transmit byte
+//   +5  LSR  read:  line status (THRE | TEMT, never DR)
+//
+// Output is buffered and written to the host in bulk: when the
+// buffer fills, on flush() (before guest syscall I/O and at
+// teardown), and at newlines if the host fd is a terminal.
+//
+// A non-blocking host fd that is not ready keeps the unwritten
+// bytes for the next flush(); a store cannot stall the guest, so
+// the backlog may grow to MAX_PENDING before further output is
+// dropped. Output is discarded once the fd reports an error
+// (e.g. the peer hung up) or is detached with set_fd(-1).
+// ============================================================
+
+class Uart : public MmioDevice
+{
+  public:
+    static constexpr uint32_t THR = 0;
+    static constexpr uint32_t LSR = 5;
+
+    static constexpr uint8_t LSR_THRE = 0x20; // transmit holding register empty
+    static constexpr uint8_t LSR_TEMT = 0x40; // transmitter empty
+
+    explicit Uart(int host_fd = 1)
+    {
+        set_fd(host_fd);
+        buffer.reserve(BUFFER_SIZE);
+    }
+
+    ~Uart() override
+    {
+        flush();
+    }
+
+    void set_fd(int host_fd)
+    {
+        flush();
+        buffer.clear();
+        fd = host_fd;
+        line_buffered = fd >= 0 && isatty(fd);
+    }
+
+    // Bytes accepted from the guest but not yet written.
+    bool pending() const
+    {
+        return !buffer.empty();
+    }
+
+    uint32_t read(uint32_t offset, unsigned) override
+    {
+        return offset == LSR ? (LSR_THRE | LSR_TEMT) : 0;
+    }
+
+    void write(uint32_t offset, uint32_t value, unsigned) override
+    {
+        if (offset != THR)
+            return;
+
+        if (buffer.size() >= MAX_PENDING)
+            return;
+
+        buffer.push_back((uint8_t)value);
+        if (buffer.size() >= flush_at || (line_buffered && value == '\n'))
+            flush();
+    }
+
+    void flush() override
+    {
+        size_t off = 0;
+        while (off < buffer.size())
+        {
+            ssize_t n = ::write(fd, buffer.data() + off, buffer.size() - off);
+            if (n > 0)
+            {
+                off += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                // Retry with the next flush, not on every store.
+                buffer.erase(buffer.begin(), buffer.begin() + off);
+                flush_at = buffer.size() + BUFFER_SIZE;
+                return;
+            }
+            break; // host side gone: drop the output
+        }
+        buffer.clear();
+        flush_at = BUFFER_SIZE;
+    }
+
+  private:
+    static constexpr size_t BUFFER_SIZE = 4096;
+    static constexpr size_t MAX_PENDING = 1 << 20;
+
+    int fd = 1;
+    bool line_buffered = false;
+    size_t flush_at = BUFFER_SIZE;
+    std::vector<uint8_t> buffer;
+};
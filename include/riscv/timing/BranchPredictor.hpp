@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// ============================================================
+// Branch predictor: gshare + BTB + return address stack
+//
+//   - conditional direction: gshare (global history XOR PC into
+//     a table of 2-bit saturating counters)
+//   - taken targets: direct-mapped BTB
+//   - returns (jalr x0, 0(ra)): return address stack
+//
+// Each predict-and-update call returns true on a misprediction.
+// ============================================================
+
+struct BranchPredictorConfig
+{
+    uint32_t history_bits; // gshare table = 2^history_bits counters
+    uint32_t btb_entries;  // power of two
+    uint32_t ras_entries;
+};
+
+class BranchPredictor
+{
+  public:
+    BranchPredictor() = default;
+
+    explicit BranchPredictor(const BranchPredictorConfig &cfg)
+        : history_mask((1u << cfg.history_bits) - 1),
+          btb_mask(cfg.btb_entries - 1),
+          counters(1u << cfg.history_bits, 1), // weakly not-taken
+          btb(cfg.btb_entries),
+          ras(cfg.ras_entries ? cfg.ras_entries : 1)
+    {
+    }
+
+    bool conditional(uint32_t pc, bool taken, uint32_t target)
+    {
+        conditionals++;
+
+        uint8_t &ctr = counters[((pc >> 2) ^ history) & history_mask];
+        bool predicted = ctr >= 2;
+        bool miss = predicted != taken;
+
+        if (taken && !miss)
+            miss = !btb_hit(pc, target);
+
+        if (taken)
+        {
+            if (ctr < 3)
+                ctr++;
+            btb_update(pc, target);
+        }
+        else if (ctr > 0)
+            ctr--;
+
+        history = ((history << 1) | taken) & history_mask;
+
+        if (miss)
+            conditional_misses++;
+        return miss;
+    }
+
+    bool jump(uint32_t pc, uint32_t target, bool is_call, bool is_return)
+    {
+        jumps++;
+
+        bool miss;
+        if (is_return && ras_depth > 0)
+        {
+            ras_top = (ras_top + ras.size() - 1) % ras.size();
+            ras_depth--;
+            miss = ras[ras_top] != target;
+        }
+        else
+        {
+            miss = !btb_hit(pc, target);
+            btb_update(pc, target);
+        }
+
+        if (is_call)
+        {
+            ras[ras_top] = pc + 4;
+            ras_top = (ras_top + 1) % ras.size();
+            if (ras_depth < ras.size())
+                ras_depth++;
+        }
+
+        if (miss)
+            jump_misses++;
+        return miss;
+    }
+
+    uint64_t conditionals = 0;
+    uint64_t conditional_misses = 0;
+    uint64_t jumps = 0;
+    uint64_t jump_misses = 0;
+
+  private:
+    struct BtbEntry
+    {
+        uint32_t pc = 0xFFFFFFFF;
+        uint32_t target = 0;
+    };
+
+    uint32_t history = 0;
+    uint32_t history_mask = 0;
+    uint32_t btb_mask = 0;
+
+    std::vector<uint8_t> counters;
+    std::vector<BtbEntry> btb;
+    std::vector<uint32_t> ras;
+    size_t ras_top = 0;
+    size_t ras_depth = 0;
+
+    bool btb_hit(uint32_t pc, uint32_t target) const
+    {
+        const BtbEntry &e = btb[(pc >> 2) & btb_mask];
+        return e.pc == pc && e.target == target;
+    }
+
+    void btb_update(uint32_t pc, uint32_t target)
+    {
+        btb[(pc >> 2) & btb_mask] = {pc, target};
+    }
+};
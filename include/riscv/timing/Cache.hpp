@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// ============================================================
+// Set-associative cache (tags only)
+//
+// Models hit/miss behaviour with true LRU replacement and
+// allocate-on-miss for both reads and writes. No data is
+// stored: the functional MemorySubsystem remains the single
+// source of truth.
+// ============================================================
+
+struct CacheConfig
+{
+    uint32_t size;  // bytes
+    uint32_t assoc; // ways
+    uint32_t line;  // bytes
+};
+
+class Cache
+{
+  public:
+    Cache() = default;
+
+    explicit Cache(const CacheConfig &cfg)
+    {
+        auto pow2 = [](uint32_t v)
+        { return v && !(v & (v - 1)); };
+
+        if (!pow2(cfg.line) || !cfg.assoc || cfg.size < cfg.line * cfg.assoc ||
+            !pow2(cfg.size / (cfg.line * cfg.assoc)))
+            throw std::invalid_argument("Cache geometry must be a power of two");
+
+        ways = cfg.assoc;
+        sets = cfg.size / (cfg.line * cfg.assoc);
+        while ((1u << line_shift) < cfg.line)
+            line_shift++;
+
+        tags.assign((size_t)sets * ways, INVALID);
+    }
+
+    // Returns true on hit. Misses allocate the line.
+    bool access(uint32_t addr)
+    {
+        accesses++;
+
+        const uint32_t line_addr = addr >> line_shift;
+        uint32_t *set = &tags[(size_t)(line_addr & (sets - 1)) * ways];
+
+        // Ways are kept in MRU..LRU order.
+        for (uint32_t w = 0; w < ways; w++)
+        {
+            if (set[w] == line_addr)
+            {
+                std::rotate(set, set + w, set + w + 1);
+                return true;
+            }
+        }
+
+        misses++;
+        std::rotate(set, set + ways - 1, set + ways);
+        set[0] = line_addr;
+        return false;
+    }
+
+    uint64_t accesses = 0;
+    uint64_t misses = 0;
+
+  private:
+    static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+    uint32_t ways = 1;
+    uint32_t sets = 1;
+    uint32_t line_shift = 0;
+    std::vector<uint32_t> tags;
+};
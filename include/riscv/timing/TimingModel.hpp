@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "riscv/core/Instruction.hpp"
+#include "riscv/platform/ElfLoader.hpp"
+#include "riscv/timing/BranchPredictor.hpp"
+#include "riscv/timing/Cache.hpp"
+
+// ============================================================
+// TimingModel
+//
+// Timing policy for CpuCore<32, TimingModel>: estimates the cycle
+// count of a simple in-order scalar RV32 core from the retired
+// instruction stream.
+//
+// Every instruction costs one cycle, plus:
+//   - L1I miss on fetch           l2_latency (+ memory_latency on L2 miss)
+//   - L1D miss on a load          same as above
+//   - conditional/jump mispredict mispredict_penalty
+//   - MUL*, DIV/REM               mul_latency - 1, div_latency - 1
+//
+// Stores allocate in L1D but retire through a store buffer and
+// never stall. Effective addresses are taken from the decoded
+// instruction, so MemorySubsystem itself is untouched.
+//
+// Estimated stall cycles are added to the guest's `cycle` CSR.
+// ============================================================
+
+struct TimingConfig
+{
+    CacheConfig l1i{32 * 1024, 4, 64};
+    CacheConfig l1d{32 * 1024, 8, 64};
+    CacheConfig l2{256 * 1024, 8, 64};
+    BranchPredictorConfig predictor{12, 512, 16};
+
+    uint32_t l2_latency = 10;
+    uint32_t memory_latency = 100;
+    uint32_t mispredict_penalty = 3;
+    uint32_t mul_latency = 3;
+    uint32_t div_latency = 34;
+
+    // Parse "key=value,..." overrides, e.g.
+    //   l1d=16k:4:32,l2=1m:16:64,memlat=120,ghr=14,btb=1024,div=20
+    // Throws std::invalid_argument on malformed input.
+    static TimingConfig parse(const std::string &spec);
+};
+
+class TimingModel
+{
+  public:
+    TimingModel();
+
+    void configure(const TimingConfig &cfg);
+
+    // Function symbols for the per-function report.
+    void set_symbols(const std::vector<ElfSymbol> &functions);
+
+    template <typename State>
+    void issue(uint32_t, const DecodedInstruction &d, const State &state)
+    {
+        if (d.opcode == 0x03 || d.opcode == 0x23)
+            mem_addr = state.reg(d.rs1) + d.imm;
+    }
+
+    template <typename State>
+    void retire(uint32_t pc, const DecodedInstruction &d, State &state)
+    {
+        FunctionStats &f = function_at(pc);
+        uint64_t extra = 0;
+
+        if (!l1i.access(pc))
+        {
+            f.l1i_misses++;
+            extra += miss_cost(pc);
+        }
+
+        switch (d.opcode)
+        {
+        case 0x03: // LOAD
+            f.l1d_accesses++;
+            if (!l1d.access(mem_addr))
+            {
+                f.l1d_misses++;
+                extra += miss_cost(mem_addr);
+            }
+            break;
+
+        case 0x23: // STORE
+            f.l1d_accesses++;
+            if (!l1d.access(mem_addr))
+            {
+                f.l1d_misses++;
+                l2.access(mem_addr); // write-allocate, no stall
+            }
+            break;
+
+        case 0x33: // RV32M
+            if (d.funct7 == 0x01)
+                extra += (d.funct3 < 4 ? config.mul_latency : config.div_latency) - 1;
+            break;
+
+        case 0x63: // BRANCH
+        {
+            f.branches++;
+            bool taken = state.pc != pc + 4;
+            if (predictor.conditional(pc, taken, state.pc))
+            {
+                f.mispredicts++;
+                extra += config.mispredict_penalty;
+            }
+            break;
+        }
+
+        case 0x6F: // JAL
+        case 0x67: // JALR
+        {
+            f.branches++;
+            bool link = d.rd == 1 || d.rd == 5;
+            bool ret = d.opcode == 0x67 && d.rd == 0 && (d.rs1 == 1 || d.rs1 == 5);
+            if (predictor.jump(pc, state.pc, link, ret))
+            {
+                f.mispredicts++;
+                extra += config.mispredict_penalty;
+            }
+            break;
+        }
+        }
+
+        f.instructions++;
+        f.cycles += 1 + extra;
+        cycles += 1 + extra;
+        state.counters.stall_cycles += extra;
+    }
+
+    uint64_t get_cycles() const
+    {
+        return cycles;
+    }
+
+    void report(std::ostream &out, uint64_t instructions, size_t top_functions = 20) const;
+
+  private:
+    // Every retired instruction is one L1I access, so
+    // `instructions` doubles as the L1I access count.
+    struct FunctionStats
+    {
+        std::string name;
+        uint32_t lo = 0;
+        uint32_t hi = 0;
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+        uint64_t l1i_misses = 0;
+        uint64_t l1d_accesses = 0;
+        uint64_t l1d_misses = 0;
+        uint64_t branches = 0; // conditional branches and jumps
+        uint64_t mispredicts = 0;
+    };
+
+    TimingConfig config;
+    Cache l1i;
+    Cache l1d;
+    Cache l2;
+    BranchPredictor predictor;
+
+    uint64_t cycles = 0;
+    uint32_t mem_addr = 0;
+
+    // functions[0] collects PCs outside every known symbol.
+    std::vector<FunctionStats> functions;
+    FunctionStats *current = nullptr;
+
+    uint64_t miss_cost(uint32_t addr)
+    {
+        return l2.access(addr) ? config.l2_latency
+                               : config.l2_latency + config.memory_latency;
+    }
+
+    FunctionStats &function_at(uint32_t pc)
+    {
+        if (pc >= current->lo && pc < current->hi)
+            return *current;
+        return lookup(pc);
+    }
+
+    FunctionStats &lookup(uint32_t pc);
+};
@@ -0,0 +1,172 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+
+#include "riscv/aot/Runtime.hpp"
+#include "riscv/core/Processor.hpp"
+#include "riscv/memory/Memory.hpp"
+#include "riscv/platform/Devices.hpp"
+#include "riscv/platform/ElfLoader.hpp"
+#include "riscv/platform/MemoryLayout.hpp"
+#include "riscv/platform/ReplayLog.hpp"
+
+// ============================================================
+// Host entry point for ahead-of-time translated guests
+//
+// Links against a translator-generated translation unit.
+// Translated blocks are dispatched through a PC-indexed table;
+// any PC without a block (ECALL, CSR, indirect targets that are
+// not block leaders) is executed by the regular CpuCore, which
+// also owns the SyscallHandler. Guest-visible behaviour is
+// therefore identical to bin/emulator, and a log taken with
+// `emulator --record` replays here unchanged.
+// ============================================================
+
+int main(int argc, char **argv)
+{
+    const char *elf = aot_image_path;
+    const char *record_path = nullptr;
+    const char *replay_path = nullptr;
+    const char *fs_root = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--record") && i + 1 < argc)
+            record_path = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (!strcmp(argv[i], "--fs-root") && i + 1 < argc)
+            fs_root = argv[++i];
+        else if (!strcmp(argv[i], "--help"))
+        {
+            std::cout << "Usage: " << argv[0]
+                      << " [--fs-root dir] [--record log | --replay log] [program.elf]\n"
+                         "Ahead-of-time translated RV32IM guest (default image: "
+                      << aot_image_path << ")\n";
+            return 0;
+        }
+        else
+            elf = argv[i];
+    }
+
+    int root_fd = -1;
+    if (fs_root)
+    {
+        root_fd = open(fs_root, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (root_fd < 0)
+        {
+            std::cerr << "Cannot open --fs-root " << fs_root << "\n";
+            return 1;
+        }
+    }
+
+    std::unique_ptr<ReplayLog> replay;
+    try
+    {
+        if (record_path)
+            replay.reset(new ReplayLog(record_path, ReplayLog::Mode::Record, elf));
+        else if (replay_path)
+            replay.reset(new ReplayLog(replay_path, ReplayLog::Mode::Replay, elf));
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    PlatformDevices devices;
+    MemorySubsystem<32> memory(default_memory_map());
+    devices.attach(memory);
+    ArchitecturalState<32> state;
+    CpuCore<32> cpu(state, memory);
+    cpu.syscalls().set_fs_root(root_fd);
+    cpu.syscalls().set_replay(replay.get());
+    devices.clock.set_tap(replay.get());
+    state.counters.tap = replay.get();
+    state.counters.clock = &devices.clock;
+
+    ElfLoader::load(elf, memory, state);
+
+    if (aot_hash_text(memory, aot_text, aot_text_count) != aot_text_hash)
+    {
+        std::cerr << "Text of " << elf << " does not match the translated image\n";
+        return 1;
+    }
+
+    // ---------------- PC-indexed dispatch table ----------------
+    uint32_t lo = 0xFFFFFFFF;
+    uint32_t hi = 0;
+    for (size_t i = 0; i < aot_text_count; i++)
+    {
+        lo = std::min(lo, aot_text[i].base);
+        hi = std::max(hi, aot_text[i].base + aot_text[i].size);
+    }
+
+    std::vector<const AotBlock *> table(hi > lo ? (hi - lo) / 4 : 0, nullptr);
+    for (size_t i = 0; i < aot_block_count; i++)
+        table[(aot_blocks[i].pc - lo) / 4] = &aot_blocks[i];
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Block being run; a Trap reaching the handler below came from it.
+    const AotBlock *b = nullptr;
+    try
+    {
+        for (;;)
+        {
+            uint32_t pc = state.pc;
+            uint32_t idx = (pc - lo) >> 2;
+
+            if (!(pc & 3) && idx < table.size() && (b = table[idx]))
+            {
+                b->fn(state, memory);
+                state.counters.instret += b->length;
+                continue;
+            }
+
+            if (!cpu.step())
+                break;
+        }
+    }
+    catch (const Trap &t)
+    {
+        // Blocks are straight-line and leave s.pc at the faulting
+        // load/store, so everything before it has retired.
+        state.counters.instret += (state.pc - b->pc) / 4;
+        print_trap(std::cerr, t, cpu.get_inst_count());
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "\n" << e.what() << "\n";
+        return 1;
+    }
+
+    try
+    {
+        if (replay)
+            replay->flush();
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "\n" << e.what() << "\n";
+        return 1;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    uint64_t insts = cpu.get_inst_count();
+
+    std::cerr << "\n--- Emulator stats ---\n";
+    std::cerr << "Instructions: " << insts << "\n";
+    std::cerr << "Time: " << seconds << " s\n";
+    if (seconds > 0)
+        std::cerr << "IPS: " << (insts / seconds) << "\n";
+
+    return 0;
+}
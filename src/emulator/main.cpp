@@ -1,24 +1,162 @@
 #include <iostream>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <chrono>
+#include <memory>
+#include <type_traits>
+#include <fcntl.h>
 
 #include "riscv/core/Processor.hpp"
 #include "riscv/memory/Memory.hpp"
+#include "riscv/platform/Devices.hpp"
 #include "riscv/platform/ElfLoader.hpp"
+#include "riscv/platform/MemoryLayout.hpp"
+#include "riscv/platform/MetricsExporter.hpp"
+#include "riscv/platform/ReplayLog.hpp"
+#include "riscv/platform/Scheduler.hpp"
+#include "riscv/timing/TimingModel.hpp"
 
-int main(int argc, char **argv)
+struct RunOptions
 {
     bool trace = false;
     const char *trace_path = "trace.log";
+    int root_fd = -1;
+    bool hpm = false;
+    const TimingConfig *timing = nullptr; // set for TimingModel cores
+    Metrics *metrics = nullptr;
+    MetricsExporter *exporter = nullptr;
+    ReplayLog *replay = nullptr;
+};
+
+template <typename Inner>
+static void attach_metrics(Instrumented<Inner> &t, Metrics *m)
+{
+    t.attach(*m);
+}
+
+template <typename Timing>
+static void attach_metrics(Timing &, Metrics *)
+{
+}
+
+// ------------------------------------------------------------
+// Load and run one guest to completion on CpuCore<32, Timing>
+// ------------------------------------------------------------
+
+template <typename Timing>
+static void run(const char *elf, const RunOptions &opt, ArchitecturalState<32> &state,
+                MemorySubsystem<32> &memory, PlatformDevices &devices)
+{
+    constexpr bool timed = std::is_base_of<TimingModel, Timing>::value;
+
+    CpuCore<32, Timing> cpu(state, memory);
+    cpu.syscalls().set_fs_root(opt.root_fd);
+    cpu.set_metrics(opt.metrics);
+    cpu.syscalls().set_replay(opt.replay);
+    attach_metrics(cpu.timing(), opt.metrics);
+    devices.clock.set_tap(opt.replay);
+    state.counters.tap = opt.replay;
+    state.counters.clock = &devices.clock;
+    state.counters.count_events = opt.hpm;
+
+    std::ofstream trace_file;
+    if (opt.trace)
+    {
+        trace_file.open(opt.trace_path);
+        cpu.set_trace(true);
+        cpu.set_trace_stream(&trace_file);
+    }
+
+    ElfImageInfo info;
+    ElfLoader::load(elf, memory, state, &info);
+
+    if constexpr (timed)
+    {
+        cpu.timing().configure(*opt.timing);
+        cpu.timing().set_symbols(info.functions);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (!opt.exporter)
+    {
+        while (cpu.step())
+        {
+        }
+    }
+    else
+    {
+        // Check the sampling clock once per batch, not per step.
+        bool running = true;
+        while (running)
+        {
+            for (int i = 0; i < 65536 && (running = cpu.step()); i++)
+            {
+            }
+            if (opt.exporter->due())
+                opt.exporter->sample(*opt.metrics, cpu.get_inst_count());
+        }
+        opt.exporter->sample(*opt.metrics, cpu.get_inst_count());
+    }
+
+    if (opt.replay)
+        opt.replay->flush();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    uint64_t insts = cpu.get_inst_count();
+
+    std::cerr << "\n--- Emulator stats ---\n";
+    std::cerr << "Instructions: " << insts << "\n";
+    std::cerr << "Time: " << seconds << " s\n";
+    if (seconds > 0)
+        std::cerr << "IPS: " << (insts / seconds) << "\n";
+
+    if constexpr (timed)
+        cpu.timing().report(std::cerr, insts);
+}
+
+int main(int argc, char **argv)
+{
+    RunOptions opt;
     const char *elf = nullptr;
+    const char *serve_path = nullptr;
+    const char *fs_root = nullptr;
+    const char *timing_spec = nullptr;
+    const char *stats_out = nullptr;
+    const char *record_path = nullptr;
+    const char *replay_path = nullptr;
+    uint64_t stats_interval = 0;
+    uint64_t quantum = 10000;
 
     for (int i = 1; i < argc; ++i)
     {
         if (!strcmp(argv[i], "--trace"))
-            trace = true;
+            opt.trace = true;
         else if (!strcmp(argv[i], "--trace-file") && i + 1 < argc)
-            trace_path = argv[++i];
+            opt.trace_path = argv[++i];
+        else if (!strcmp(argv[i], "--serve") && i + 1 < argc)
+            serve_path = argv[++i];
+        else if (!strcmp(argv[i], "--quantum") && i + 1 < argc)
+            quantum = strtoull(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--fs-root") && i + 1 < argc)
+            fs_root = argv[++i];
+        else if (!strcmp(argv[i], "--hpm"))
+            opt.hpm = true;
+        else if (!strcmp(argv[i], "--timing"))
+            timing_spec = "";
+        else if (!strcmp(argv[i], "--timing-config") && i + 1 < argc)
+            timing_spec = argv[++i];
+        else if (!strcmp(argv[i], "--stats-interval") && i + 1 < argc)
+            stats_interval = strtoull(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--stats-out") && i + 1 < argc)
+            stats_out = argv[++i];
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+            record_path = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+            replay_path = argv[++i];
         if (!strcmp(argv[i], "--version"))
         {
             std::cout << "rv32im-emulator 1.0 (RV32IM user-mode)\n";
@@ -27,7 +165,23 @@ int main(int argc, char **argv)
         if (!strcmp(argv[i], "--help"))
         {
             std::cout << "Usage: emulator [--trace] [--trace-file file] program.elf\n"
-                         "RV32IM user-mode emulator\n";
+                         "       emulator --serve socket [--quantum n] program.elf\n"
+                         "RV32IM user-mode emulator\n"
+                         "\n"
+                         "  --serve socket  run one guest per connection on a Unix socket\n"
+                         "  --quantum n     instructions per scheduling slice (default 10000)\n"
+                         "  --fs-root dir   let the guest open files beneath dir\n"
+                         "  --hpm           count loads/stores/branches/muldiv in hpmcounter3-6\n"
+                         "  --timing        estimate cycles with the cache/branch timing model\n"
+                         "  --timing-config spec\n"
+                         "                  as --timing, overriding defaults, e.g.\n"
+                         "                  l1d=16k:4:64,l2=1m:16:64,memlat=120,ghr=14,div=20\n"
+                         "  --stats-interval ms\n"
+                         "                  sample emulator metrics every ms (default 1000)\n"
+                         "  --stats-out target\n"
+                         "                  JSON lines to a file or unix:/path (default stats.jsonl)\n"
+                         "  --record log    log syscall inputs, time and counter reads for --replay\n"
+                         "  --replay log    re-run a recorded guest bit-identically from its log\n";
             return 0;
         }
 
@@ -41,43 +195,111 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    MemoryMap map{
+    if (fs_root)
+    {
+        opt.root_fd = open(fs_root, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (opt.root_fd < 0)
         {
-            {0x00000000, 4 * 1024 * 1024, MemoryRegionType::RAM},   // program
-            {0x00400000, 124 * 1024 * 1024, MemoryRegionType::RAM}, // stack + heap
-            {0x10000000, 0x1000, MemoryRegionType::MMIO},           // UART
-        }};
-
-    MemorySubsystem<32> memory(map);
-    ArchitecturalState<32> state;
-    CpuCore<32> cpu(state, memory);
+            std::cerr << "Cannot open --fs-root " << fs_root << "\n";
+            return 1;
+        }
+    }
 
-    std::ofstream trace_file;
-    if (trace)
+    std::unique_ptr<Metrics> metrics;
+    std::unique_ptr<MetricsExporter> exporter;
+    if (stats_interval || stats_out)
     {
-        trace_file.open(trace_path);
-        cpu.set_trace(true);
-        cpu.set_trace_stream(&trace_file);
+        try
+        {
+            metrics.reset(new Metrics(default_memory_map()));
+            exporter.reset(new MetricsExporter(stats_out ? stats_out : "stats.jsonl",
+                                               stats_interval ? stats_interval : 1000));
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        opt.metrics = metrics.get();
+        opt.exporter = exporter.get();
     }
 
-    ElfLoader::load(elf, memory, state);
-
-    auto start = std::chrono::high_resolution_clock::now();
+    std::unique_ptr<ReplayLog> replay;
+    if (record_path || replay_path)
+    {
+        if (serve_path || (record_path && replay_path))
+        {
+            std::cerr << "--record/--replay take a single guest and cannot be combined\n";
+            return 1;
+        }
+        try
+        {
+            replay.reset(record_path ? new ReplayLog(record_path, ReplayLog::Mode::Record, elf)
+                                     : new ReplayLog(replay_path, ReplayLog::Mode::Replay, elf));
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        opt.replay = replay.get();
+    }
 
-    while (cpu.step())
+    if (serve_path)
     {
+        // Served guests run on the functional core with no trace file.
+        if (opt.trace || timing_spec)
+        {
+            std::cerr << "--trace and --timing cannot be combined with --serve\n";
+            return 1;
+        }
+
+        GuestScheduler scheduler(elf, quantum);
+        scheduler.set_fs_root(opt.root_fd);
+        scheduler.set_hpm(opt.hpm);
+        scheduler.set_metrics(opt.metrics, opt.exporter);
+        scheduler.listen_unix(serve_path);
+        scheduler.run();
+        return 0;
     }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    double seconds = std::chrono::duration<double>(end - start).count();
+    PlatformDevices devices;
+    MemorySubsystem<32> memory(default_memory_map());
+    devices.attach(memory);
+    ArchitecturalState<32> state;
 
-    uint64_t insts = cpu.get_inst_count();
+    TimingConfig config;
+    if (timing_spec)
+    {
+        try
+        {
+            config = TimingConfig::parse(timing_spec);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        opt.timing = &config;
+    }
 
-    std::cerr << "\n--- Emulator stats ---\n";
-    std::cerr << "Instructions: " << insts << "\n";
-    std::cerr << "Time: " << seconds << " s\n";
-    if (seconds > 0)
-        std::cerr << "IPS: " << (insts / seconds) << "\n";
+    try
+    {
+        if (!timing_spec && !opt.metrics)
+            run<FunctionalTiming>(elf, opt, state, memory, devices);
+        else if (!timing_spec)
+            run<Instrumented<>>(elf, opt, state, memory, devices);
+        else if (!opt.metrics)
+            run<TimingModel>(elf, opt, state, memory, devices);
+        else
+            run<Instrumented<TimingModel>>(elf, opt, state, memory, devices);
+    }
+    catch (const std::runtime_error &e)
+    {
+        // Unreadable ELF, replay divergence or a truncated log
+        std::cerr << "\n" << e.what() << "\n";
+        return 1;
+    }
 
     return 0;
 }
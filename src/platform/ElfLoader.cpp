@@ -15,7 +15,8 @@ uint32_t g_image_end = 0;
 
 bool ElfLoader::load(const std::string &path,
                      MemorySubsystem<32> &memory,
-                     ArchitecturalState<32> &state)
+                     ArchitecturalState<32> &state,
+                     ElfImageInfo *info)
 {
     std::ifstream file(path, std::ios::binary);
     if (!file)
@@ -63,6 +64,9 @@ bool ElfLoader::load(const std::string &path,
             memory.write_byte(vaddr + j, 0);
 
         g_image_end = std::max(g_image_end, vaddr + memsz);
+
+        if (info)
+            info->segments.push_back({vaddr, memsz, (ph.p_flags & PF_X) != 0});
     }
 
     // ---------------- Apply relocations ----------------
@@ -116,6 +120,39 @@ bool ElfLoader::load(const std::string &path,
         }
     }
 
+    // ---------------- Collect function symbols ----------------
+    if (info)
+    {
+        info->entry = ehdr->e_entry;
+
+        for (int i = 0; i < ehdr->e_shnum; i++)
+        {
+            const Elf32_Shdr &sh = shdrs[i];
+            if (sh.sh_type != SHT_SYMTAB)
+                continue;
+
+            const Elf32_Sym *syms =
+                (const Elf32_Sym *)(data.data() + sh.sh_offset);
+            const char *strtab =
+                (const char *)(data.data() + shdrs[sh.sh_link].sh_offset);
+
+            size_t count = sh.sh_size / sizeof(Elf32_Sym);
+
+            for (size_t j = 0; j < count; j++)
+            {
+                const Elf32_Sym &s = syms[j];
+                if (ELF32_ST_TYPE(s.st_info) != STT_FUNC || s.st_shndx == SHN_UNDEF)
+                    continue;
+
+                info->functions.push_back({strtab + s.st_name, s.st_value, s.st_size});
+            }
+        }
+
+        std::sort(info->functions.begin(), info->functions.end(),
+                  [](const ElfSymbol &a, const ElfSymbol &b)
+                  { return a.addr < b.addr; });
+    }
+
     state.set_pc(ehdr->e_entry);
     return true;
 }
@@ -0,0 +1,165 @@
+#include "riscv/platform/MetricsExporter.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ------------------------------------------------------------
+// Construction
+// ------------------------------------------------------------
+
+MetricsExporter::MetricsExporter(const std::string &target, uint64_t interval_ms)
+    : interval_us(interval_ms * 1000),
+      next_us(interval_ms * 1000)
+{
+    if (target.compare(0, 5, "unix:") == 0)
+    {
+        std::string path = target.substr(5);
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path))
+            throw std::runtime_error("Metrics socket path too long");
+        std::strcpy(addr.sun_path, path.c_str());
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            if (fd >= 0)
+                close(fd);
+            throw std::runtime_error("Cannot connect to metrics socket " + path);
+        }
+
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        is_socket = true;
+    }
+    else
+    {
+        fd = open(target.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open metrics file " + target);
+    }
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    if (fd < 0)
+        return;
+
+    // Best effort: give a slow collector the final sample.
+    if (is_socket && !pending.empty())
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    send_pending();
+    close(fd);
+}
+
+int MetricsExporter::until_due_ms() const
+{
+    uint64_t now = clock.now();
+    return now >= next_us ? 0 : (int)((next_us - now + 999) / 1000);
+}
+
+// ------------------------------------------------------------
+// Output
+// ------------------------------------------------------------
+
+void MetricsExporter::send_pending()
+{
+    size_t off = 0;
+
+    while (fd >= 0 && off < pending.size())
+    {
+        ssize_t n = is_socket
+                        ? ::send(fd, pending.data() + off, pending.size() - off, MSG_NOSIGNAL)
+                        : ::write(fd, pending.data() + off, pending.size() - off);
+        if (n > 0)
+        {
+            off += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        std::cerr << "metrics: output closed, sampling stopped\n";
+        close(fd);
+        fd = -1;
+    }
+
+    pending.erase(0, off);
+}
+
+void MetricsExporter::sample(const Metrics &m, uint64_t instret)
+{
+    const uint64_t now = clock.now();
+    const uint64_t span = now - last_us;
+
+    std::ostringstream out;
+    out << "{\"t_ms\":" << now / 1000
+        << ",\"instret\":" << instret
+        << ",\"ips\":" << (span ? (instret - last_instret) * 1000000 / span : 0);
+
+    if (m.instrumented)
+    {
+        out << ",\"classes\":{";
+        for (size_t i = 0; i < static_cast<size_t>(InstClass::Count); i++)
+            out << (i ? "," : "") << '"' << inst_class_name(static_cast<InstClass>(i))
+                << "\":" << m.classes[i];
+
+        out << "},\"memory\":[";
+        for (size_t i = 0; i < m.regions.size(); i++)
+        {
+            const Metrics::RegionCounters &r = m.regions[i];
+            char base[16];
+            std::snprintf(base, sizeof(base), "0x%08x", r.base);
+            out << (i ? "," : "") << "{\"base\":"
+                << (r.size ? '"' + std::string(base) + '"' : std::string("null"))
+                << ",\"loads\":" << r.loads << ",\"stores\":" << r.stores << "}";
+        }
+        out << "]";
+    }
+
+    out << ",\"traps\":{";
+    for (size_t i = 0; i < TRAP_CAUSE_COUNT; i++)
+        out << (i ? "," : "") << '"' << trap_cause_name(static_cast<TrapCause>(i))
+            << "\":" << m.traps[i];
+
+    out << "},\"syscalls\":{";
+    bool first = true;
+    for (const auto &kv : m.syscalls)
+    {
+        const Metrics::SyscallCounters &c = kv.second;
+        out << (first ? "" : ",") << '"' << kv.first << "\":{\"calls\":" << c.calls
+            << ",\"blocked\":" << c.blocked << ",\"bytes\":" << c.bytes
+            << ",\"host_us\":" << c.host_ns / 1000 << "}";
+        first = false;
+    }
+    out << "},\"bytes_in\":" << m.bytes_in
+        << ",\"bytes_out\":" << m.bytes_out
+        << ",\"syscall_us\":" << m.syscall_ns / 1000;
+
+    if (m.guests_started)
+        out << ",\"guests_started\":" << m.guests_started
+            << ",\"guests_live\":" << m.guests_live;
+
+    out << ",\"dropped\":" << dropped << "}\n";
+
+    std::string line = out.str();
+    if (pending.size() + line.size() > MAX_PENDING)
+        dropped++;
+    else
+        pending += line;
+    send_pending();
+
+    last_us = now;
+    last_instret = instret;
+    next_us = now + interval_us;
+}
@@ -0,0 +1,370 @@
+#include "riscv/platform/ReplayLog.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unistd.h>
+
+// Signals that end a recording early. Their handler writes out
+// what is buffered, then lets the default action run.
+static const int FLUSH_SIGNALS[] = {SIGINT, SIGTERM, SIGHUP};
+static struct sigaction saved_actions[3];
+static ReplayLog *recording = nullptr;
+
+static uint64_t hash_file(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Failed to open ELF");
+
+    uint64_t h = ReplayLog::FNV_OFFSET;
+    char buf[65536];
+    while (in.read(buf, sizeof(buf)) || in.gcount())
+        h = ReplayLog::hash(reinterpret_cast<const uint8_t *>(buf), (size_t)in.gcount(), h);
+    return h;
+}
+
+uint64_t ReplayLog::hash(const uint8_t *data, size_t len, uint64_t h)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// ------------------------------------------------------------
+// Construction
+// ------------------------------------------------------------
+
+ReplayLog::ReplayLog(const std::string &path, Mode m, const std::string &elf_path)
+    : mode(m)
+{
+    const uint64_t elf_hash = hash_file(elf_path);
+
+    if (mode == Mode::Record)
+    {
+        out_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out_fd < 0)
+            throw std::runtime_error("Cannot open replay log " + path);
+
+        put("RVRL", 4);
+        put(&VERSION, 1);
+        put(&elf_hash, sizeof(elf_hash));
+
+        recording = this;
+        struct sigaction sa{};
+        sa.sa_handler = on_signal;
+        sa.sa_flags = SA_RESETHAND;
+        sigemptyset(&sa.sa_mask);
+        for (size_t i = 0; i < std::size(FLUSH_SIGNALS); i++)
+            sigaction(FLUSH_SIGNALS[i], &sa, &saved_actions[i]);
+        return;
+    }
+
+    file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("Cannot open replay log " + path);
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+    char magic[4];
+    uint64_t recorded_hash;
+    if (std::fread(magic, 1, 4, file) != 4 || std::memcmp(magic, "RVRL", 4) ||
+        std::fgetc(file) != VERSION ||
+        std::fread(&recorded_hash, 1, sizeof(recorded_hash), file) != sizeof(recorded_hash))
+    {
+        std::fclose(file);
+        throw std::runtime_error("Not a replay log: " + path);
+    }
+
+    if (recorded_hash != elf_hash)
+    {
+        std::fclose(file);
+        throw std::runtime_error("Replay log " + path + " was recorded from a different ELF");
+    }
+}
+
+// The caller flush()es first to see write errors; this is the
+// last resort for runs that end by an exception.
+ReplayLog::~ReplayLog()
+{
+    if (file)
+        std::fclose(file);
+
+    if (out_fd >= 0)
+    {
+        try
+        {
+            flush();
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+        for (size_t i = 0; i < std::size(FLUSH_SIGNALS); i++)
+            sigaction(FLUSH_SIGNALS[i], &saved_actions[i], nullptr);
+        recording = nullptr;
+        ::close(out_fd);
+    }
+}
+
+// Only async-signal-safe calls from here. A flush() in progress
+// is left alone; the record being added when the signal hit may
+// be cut short, which replay reports as the end of the log.
+void ReplayLog::on_signal(int sig)
+{
+    ReplayLog *log = recording;
+    if (log && !log->flushing)
+    {
+        size_t off = 0;
+        while (off < log->out_len)
+        {
+            ssize_t n = ::write(log->out_fd, log->out + off, log->out_len - off);
+            if (n > 0)
+                off += n;
+            else if (n == 0 || errno != EINTR)
+                break;
+        }
+    }
+    ::raise(sig); // SA_RESETHAND: the default action
+}
+
+// ------------------------------------------------------------
+// Output
+// ------------------------------------------------------------
+
+void ReplayLog::flush()
+{
+    if (out_fd < 0)
+        return;
+
+    flushing = true;
+    size_t off = 0;
+    while (off < out_len)
+    {
+        ssize_t n = ::write(out_fd, out + off, out_len - off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            flushing = false;
+            throw std::runtime_error(std::string("Cannot write replay log: ") +
+                                     std::strerror(n < 0 ? errno : ENOSPC));
+        }
+        off += n;
+    }
+    written += out_len;
+    out_len = 0;
+    flushing = false;
+}
+
+void ReplayLog::put(const void *data, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (len)
+    {
+        if (out_len == OUT_SIZE)
+            flush();
+        size_t n = std::min(len, OUT_SIZE - out_len);
+        std::memcpy(out + out_len, p, n);
+        out_len += n;
+        p += n;
+        len -= n;
+    }
+}
+
+// Rewrites the fixed fields put_syscall() logged at `at`.
+void ReplayLog::update_mapped(uint64_t at, uint64_t size, uint64_t mtime_ns)
+{
+    flush();
+
+    uint8_t buf[16];
+    std::memcpy(buf, &size, 8);
+    std::memcpy(buf + 8, &mtime_ns, 8);
+    if (::pwrite(out_fd, buf, sizeof(buf), (off_t)at) != (ssize_t)sizeof(buf))
+        throw std::runtime_error(std::string("Cannot write replay log: ") + std::strerror(errno));
+}
+
+// ------------------------------------------------------------
+// Encoding
+// ------------------------------------------------------------
+
+void ReplayLog::put_u64(uint64_t v)
+{
+    uint8_t buf[10];
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        buf[n++] = (uint8_t)(v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    buf[n++] = (uint8_t)v;
+    put(buf, n);
+}
+
+void ReplayLog::put_fixed64(uint64_t v)
+{
+    put(&v, sizeof(v));
+}
+
+uint64_t ReplayLog::get_fixed64()
+{
+    uint64_t v;
+    if (std::fread(&v, 1, sizeof(v), file) != sizeof(v))
+        throw std::runtime_error("replay: log ended early");
+    return v;
+}
+
+uint64_t ReplayLog::get_u64()
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        int c = std::getc(file);
+        if (c == EOF)
+            throw std::runtime_error("replay: log ended early");
+        v |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+            return v;
+    }
+    throw std::runtime_error("replay: corrupt log");
+}
+
+uint8_t ReplayLog::get_tag(char expected, const char *what)
+{
+    int c = std::getc(file);
+    if (c == EOF)
+        throw std::runtime_error(std::string("replay: log ended before ") + what +
+                                 " (record " + std::to_string(records) + ")");
+    if (c != 'S' && c != 'T' && c != 'C')
+        throw std::runtime_error("replay: corrupt log");
+    if (c != expected)
+        throw std::runtime_error(std::string("replay: guest diverged at record ") +
+                                 std::to_string(records) + ": expected " +
+                                 (c == 'S' ? "a syscall" : c == 'T' ? "a time read" : "a counter read") +
+                                 ", guest performed " + what);
+    records++;
+    return (uint8_t)c;
+}
+
+// ------------------------------------------------------------
+// Syscalls
+// ------------------------------------------------------------
+
+uint64_t ReplayLog::put_syscall(uint32_t nr, uint32_t result, uint64_t payload,
+                                const MappedFile *mapped, uint32_t outputs)
+{
+    uint64_t at = 0;
+
+    put("S", 1);
+    put_u64(nr);
+    put_u64(result);
+    put_u64(payload);
+    put_u64(mapped != nullptr);
+    if (mapped)
+    {
+        put_u64(mapped->path.size());
+        put(mapped->path.data(), mapped->path.size());
+        at = written + out_len;
+        put_fixed64(mapped->size);
+        put_fixed64(mapped->mtime_ns);
+    }
+    put_u64(outputs);
+    records++;
+    return at;
+}
+
+void ReplayLog::put_output(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    put_u64(addr);
+    put_u64(len);
+    put(data, len);
+}
+
+ReplayLog::Syscall ReplayLog::next_syscall(uint32_t nr)
+{
+    get_tag('S', "a syscall");
+
+    uint32_t logged = (uint32_t)get_u64();
+    if (logged != nr)
+        throw std::runtime_error("replay: guest diverged at record " +
+                                 std::to_string(position()) + ": expected syscall " +
+                                 std::to_string(logged) + ", got " + std::to_string(nr));
+
+    Syscall s;
+    s.result = (uint32_t)get_u64();
+    s.payload = get_u64();
+    s.mapped = get_u64() != 0;
+    if (s.mapped)
+    {
+        s.file.path.resize((size_t)get_u64());
+        if (std::fread(&s.file.path[0], 1, s.file.path.size(), file) != s.file.path.size())
+            throw std::runtime_error("replay: log ended early");
+        s.file.size = get_fixed64();
+        s.file.mtime_ns = get_fixed64();
+    }
+    s.outputs = (uint32_t)get_u64();
+    return s;
+}
+
+uint32_t ReplayLog::next_output(std::vector<uint8_t> &data)
+{
+    uint32_t addr = (uint32_t)get_u64();
+    data.resize((size_t)get_u64());
+    if (std::fread(data.data(), 1, data.size(), file) != data.size())
+        throw std::runtime_error("replay: log ended early");
+    return addr;
+}
+
+// ------------------------------------------------------------
+// Time
+// ------------------------------------------------------------
+
+// Deltas are zigzag-encoded: guest time is monotonic, but the
+// encoding does not rely on it.
+uint64_t ReplayLog::time(uint64_t now)
+{
+    if (mode == Mode::Record)
+    {
+        int64_t delta = (int64_t)(now - last_time);
+        put("T", 1);
+        put_u64(((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+        records++;
+        last_time = now;
+        return now;
+    }
+
+    get_tag('T', "a time read");
+    uint64_t z = get_u64();
+    last_time += (uint64_t)((int64_t)(z >> 1) ^ -(int64_t)(z & 1));
+    return last_time;
+}
+
+// ------------------------------------------------------------
+// Counters
+// ------------------------------------------------------------
+
+uint32_t ReplayLog::counter(uint32_t csr, uint32_t value)
+{
+    if (mode == Mode::Record)
+    {
+        put("C", 1);
+        put_u64(csr);
+        put_u64(value);
+        records++;
+        return value;
+    }
+
+    get_tag('C', "a counter read");
+    uint32_t logged = (uint32_t)get_u64();
+    if (logged != csr)
+        throw std::runtime_error("replay: guest diverged at record " + std::to_string(position()) +
+                                 ": expected a read of CSR " + std::to_string(logged) +
+                                 ", got " + std::to_string(csr));
+    return (uint32_t)get_u64();
+}
@@ -0,0 +1,408 @@
+#include "riscv/platform/Scheduler.hpp"
+#include "riscv/core/Processor.hpp"
+#include "riscv/platform/Devices.hpp"
+#include "riscv/platform/ElfLoader.hpp"
+#include "riscv/platform/MemoryLayout.hpp"
+#include "riscv/platform/MetricsExporter.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ------------------------------------------------------------
+// One guest: address space, registers, core and host fds
+// ------------------------------------------------------------
+
+struct GuestSession
+{
+    PlatformDevices devices;
+    MemorySubsystem<32> memory;
+    ArchitecturalState<32> state;
+    CpuCore<32> cpu;
+
+    int in_fd;
+    int out_fd;
+    bool owns_fds;
+
+    // Descriptors currently registered with epoll (in, out).
+    bool in_registered = false;
+    bool out_registered = false;
+
+    // Exited; waiting until its UART output is written.
+    bool draining = false;
+    uint64_t drain_deadline = 0;
+
+    GuestSession(int in, int out, bool owns)
+        : devices(out),
+          memory(default_memory_map()),
+          state(),
+          cpu(state, memory),
+          in_fd(in),
+          out_fd(out),
+          owns_fds(owns)
+    {
+        devices.attach(memory);
+        state.counters.clock = &devices.clock;
+    }
+};
+
+static void set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0)
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// ------------------------------------------------------------
+// Construction
+// ------------------------------------------------------------
+
+GuestScheduler::GuestScheduler(const std::string &elf_path, uint64_t quantum)
+    : elf(elf_path), quantum(quantum ? quantum : 1)
+{
+    // A client hanging up must not kill every other guest.
+    signal(SIGPIPE, SIG_IGN);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+        throw std::runtime_error("epoll_create1 failed");
+
+    spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+GuestScheduler::~GuestScheduler()
+{
+    if (listen_fd >= 0)
+    {
+        close(listen_fd);
+        unlink(listen_path.c_str());
+    }
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    if (spare_fd >= 0)
+        close(spare_fd);
+}
+
+void GuestScheduler::spawn(int in_fd, int out_fd, bool owns_fds)
+{
+    set_nonblocking(in_fd);
+    set_nonblocking(out_fd);
+
+    auto *g = new GuestSession(in_fd, out_fd, owns_fds);
+
+    if (spare_fd >= 0)
+        close(spare_fd);
+    try
+    {
+        ElfLoader::load(elf, g->memory, g->state);
+        spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    catch (const std::runtime_error &e)
+    {
+        spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+        // Only this connection is lost; running guests carry on.
+        std::cerr << "serve: cannot start guest: " << e.what() << "\n";
+        delete g;
+        if (owns_fds)
+        {
+            close(in_fd);
+            if (out_fd != in_fd)
+                close(out_fd);
+        }
+        return;
+    }
+    g->cpu.syscalls().bind_stdio(in_fd, out_fd, true);
+    g->cpu.syscalls().set_fs_root(root_fd);
+    g->cpu.set_metrics(metrics);
+    g->state.counters.count_events = hpm;
+
+    live++;
+    if (metrics)
+    {
+        metrics->guests_started++;
+        metrics->guests_live = live;
+    }
+    runnable.push_back(g);
+}
+
+void GuestScheduler::listen_unix(const std::string &path)
+{
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("Socket path too long");
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        throw std::runtime_error("socket failed");
+
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+
+    if (bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, SOMAXCONN) < 0)
+        throw std::runtime_error("Failed to listen on " + path);
+
+    listen_path = path;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // nullptr marks the listener
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+}
+
+// ------------------------------------------------------------
+// Event loop
+// ------------------------------------------------------------
+
+void GuestScheduler::accept_clients()
+{
+    for (;;)
+    {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+                pause_accept();
+            return; // EAGAIN: backlog drained
+        }
+        spawn(fd, fd, true);
+    }
+}
+
+// The listener is level-triggered: with no descriptor to accept
+// into, it would report ready forever. Take it out of the epoll
+// set until a guest exits or the back-off expires.
+void GuestScheduler::pause_accept()
+{
+    if (!accept_paused)
+    {
+        std::cerr << "serve: out of file descriptors, pausing accept\n";
+        epoll_event ev{};
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, listen_fd, &ev);
+        accept_paused = true;
+    }
+    accept_resume_us = clock.now() + ACCEPT_BACKOFF_US;
+}
+
+void GuestScheduler::resume_accept()
+{
+    if (!accept_paused)
+        return;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, listen_fd, &ev);
+    accept_paused = false;
+}
+
+// How long epoll_wait may sleep: not at all while a guest is
+// runnable, otherwise until the next sample, accept retry or
+// drain deadline.
+int GuestScheduler::timeout_ms() const
+{
+    if (!runnable.empty())
+        return 0;
+
+    const uint64_t now = clock.now();
+    int ms = stats ? stats->until_due_ms() : -1;
+
+    auto until = [&](uint64_t deadline) {
+        int wait = now >= deadline ? 0 : (int)((deadline - now + 999) / 1000);
+        ms = ms < 0 ? wait : std::min(ms, wait);
+    };
+    if (accept_paused)
+        until(accept_resume_us);
+    for (const GuestSession *g : draining)
+        until(g->drain_deadline);
+    return ms;
+}
+
+void GuestScheduler::run_quantum(GuestSession *g)
+{
+    const uint64_t before = g->cpu.get_inst_count();
+
+    for (uint64_t i = 0; i < quantum; i++)
+    {
+        if (!g->cpu.step())
+        {
+            retired += g->cpu.get_inst_count() - before;
+            finish(g);
+            return;
+        }
+        if (g->cpu.is_waiting())
+        {
+            retired += g->cpu.get_inst_count() - before;
+            wait_for(g);
+            return;
+        }
+    }
+
+    retired += g->cpu.get_inst_count() - before;
+    runnable.push_back(g);
+}
+
+// Arm a one-shot epoll notification for the descriptor the guest
+// blocked on. The guest is not scheduled again until it fires.
+void GuestScheduler::wait_for(GuestSession *g)
+{
+    auto &sys = g->cpu.syscalls();
+    const int fd = sys.wait_fd();
+    const bool for_write = sys.wait_for_write();
+
+    // in_fd == out_fd (sockets) shares one registration.
+    bool &registered = (fd == g->in_fd) ? g->in_registered : g->out_registered;
+
+    epoll_event ev{};
+    ev.events = (for_write ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT | EPOLLRDHUP;
+    ev.data.ptr = g;
+
+    if (epoll_ctl(epoll_fd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        // Not pollable (e.g. a regular file): just retry later.
+        runnable.push_back(g);
+        return;
+    }
+    registered = true;
+}
+
+// The guest has exited. Hand the client its last UART output while
+// the socket is still open: whatever the socket cannot take now is
+// written as EPOLLOUT allows, and dropped at the drain deadline.
+void GuestScheduler::finish(GuestSession *g)
+{
+    live--;
+    if (metrics)
+        metrics->guests_live = live;
+
+    g->memory.flush_devices();
+    if (!g->devices.uart.pending())
+    {
+        close_session(g);
+        return;
+    }
+
+    bool &registered = (g->out_fd == g->in_fd) ? g->in_registered : g->out_registered;
+
+    epoll_event ev{};
+    ev.events = EPOLLOUT | EPOLLONESHOT;
+    ev.data.ptr = g;
+    if (epoll_ctl(epoll_fd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, g->out_fd, &ev) < 0)
+    {
+        close_session(g);
+        return;
+    }
+    registered = true;
+
+    g->draining = true;
+    g->drain_deadline = clock.now() + DRAIN_TIMEOUT_US;
+    draining.push_back(g);
+}
+
+// EPOLLOUT on a draining session.
+void GuestScheduler::drain(GuestSession *g)
+{
+    g->devices.uart.flush();
+    if (g->devices.uart.pending())
+    {
+        epoll_event ev{};
+        ev.events = EPOLLOUT | EPOLLONESHOT;
+        ev.data.ptr = g;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, g->out_fd, &ev) == 0)
+            return;
+    }
+
+    draining.erase(std::find(draining.begin(), draining.end(), g));
+    close_session(g);
+}
+
+void GuestScheduler::expire_drains()
+{
+    const uint64_t now = clock.now();
+    for (size_t i = 0; i < draining.size();)
+    {
+        GuestSession *g = draining[i];
+        if (now < g->drain_deadline)
+        {
+            i++;
+            continue;
+        }
+        draining.erase(draining.begin() + i);
+        close_session(g);
+    }
+}
+
+void GuestScheduler::close_session(GuestSession *g)
+{
+    g->devices.uart.set_fd(-1);
+
+    if (g->in_registered)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, g->in_fd, nullptr);
+    if (g->out_registered && g->out_fd != g->in_fd)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, g->out_fd, nullptr);
+
+    if (g->owns_fds)
+    {
+        close(g->in_fd);
+        if (g->out_fd != g->in_fd)
+            close(g->out_fd);
+    }
+
+    delete g;
+
+    // A descriptor was freed: a paused listener can accept again.
+    resume_accept();
+}
+
+void GuestScheduler::run()
+{
+    epoll_event events[64];
+
+    while (live > 0 || listen_fd >= 0 || !draining.empty())
+    {
+        int n = epoll_wait(epoll_fd, events, 64, timeout_ms());
+        if (n < 0 && errno != EINTR)
+            throw std::runtime_error("epoll_wait failed");
+
+        if (accept_paused && clock.now() >= accept_resume_us)
+            resume_accept();
+
+        for (int i = 0; i < n; i++)
+        {
+            auto *g = static_cast<GuestSession *>(events[i].data.ptr);
+            if (!g)
+                accept_clients();
+            else if (g->draining)
+                drain(g);
+            else
+                runnable.push_back(g);
+        }
+        expire_drains();
+
+        // One quantum for every guest that is runnable right now.
+        for (size_t count = runnable.size(); count > 0; count--)
+        {
+            GuestSession *g = runnable.front();
+            runnable.pop_front();
+            run_quantum(g);
+        }
+
+        if (stats && stats->due())
+            stats->sample(*metrics, retired);
+    }
+
+    if (stats)
+        stats->sample(*metrics, retired);
+}
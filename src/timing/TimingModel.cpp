@@ -0,0 +1,224 @@
+#include "riscv/timing/TimingModel.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+// ------------------------------------------------------------
+// Configuration parsing
+// ------------------------------------------------------------
+
+static uint32_t parse_size(const std::string &key, const std::string &text)
+{
+    char *end = nullptr;
+    unsigned long v = strtoul(text.c_str(), &end, 0);
+    if (end == text.c_str())
+        throw std::invalid_argument("timing: bad number for " + key + ": " + text);
+
+    if (*end == 'k' || *end == 'K')
+        v <<= 10, end++;
+    else if (*end == 'm' || *end == 'M')
+        v <<= 20, end++;
+
+    if (*end)
+        throw std::invalid_argument("timing: bad number for " + key + ": " + text);
+    return (uint32_t)v;
+}
+
+// size:assoc:line
+static CacheConfig parse_cache(const std::string &key, const std::string &text)
+{
+    size_t a = text.find(':');
+    size_t b = a == std::string::npos ? a : text.find(':', a + 1);
+    if (b == std::string::npos)
+        throw std::invalid_argument("timing: " + key + " expects size:assoc:line");
+
+    CacheConfig c{
+        parse_size(key, text.substr(0, a)),
+        parse_size(key, text.substr(a + 1, b - a - 1)),
+        parse_size(key, text.substr(b + 1))};
+    Cache check(c); // validates geometry
+    return c;
+}
+
+TimingConfig TimingConfig::parse(const std::string &spec)
+{
+    TimingConfig cfg;
+    std::stringstream ss(spec);
+    std::string item;
+
+    while (std::getline(ss, item, ','))
+    {
+        if (item.empty())
+            continue;
+
+        size_t eq = item.find('=');
+        if (eq == std::string::npos)
+            throw std::invalid_argument("timing: expected key=value, got " + item);
+
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+
+        if (key == "l1i")
+            cfg.l1i = parse_cache(key, value);
+        else if (key == "l1d")
+            cfg.l1d = parse_cache(key, value);
+        else if (key == "l2")
+            cfg.l2 = parse_cache(key, value);
+        else if (key == "l2lat")
+            cfg.l2_latency = parse_size(key, value);
+        else if (key == "memlat")
+            cfg.memory_latency = parse_size(key, value);
+        else if (key == "ghr")
+            cfg.predictor.history_bits = parse_size(key, value);
+        else if (key == "btb")
+            cfg.predictor.btb_entries = parse_size(key, value);
+        else if (key == "ras")
+            cfg.predictor.ras_entries = parse_size(key, value);
+        else if (key == "mispredict")
+            cfg.mispredict_penalty = parse_size(key, value);
+        else if (key == "mul")
+            cfg.mul_latency = parse_size(key, value);
+        else if (key == "div")
+            cfg.div_latency = parse_size(key, value);
+        else
+            throw std::invalid_argument("timing: unknown key " + key);
+    }
+
+    uint32_t btb = cfg.predictor.btb_entries;
+    if (cfg.predictor.history_bits == 0 || cfg.predictor.history_bits > 24)
+        throw std::invalid_argument("timing: ghr must be 1..24");
+    if (!btb || (btb & (btb - 1)))
+        throw std::invalid_argument("timing: btb must be a power of two");
+    if (!cfg.mul_latency || !cfg.div_latency)
+        throw std::invalid_argument("timing: mul/div latency must be at least 1");
+
+    return cfg;
+}
+
+// ------------------------------------------------------------
+// Model
+// ------------------------------------------------------------
+
+TimingModel::TimingModel()
+{
+    configure(TimingConfig());
+}
+
+void TimingModel::configure(const TimingConfig &cfg)
+{
+    config = cfg;
+    l1i = Cache(cfg.l1i);
+    l1d = Cache(cfg.l1d);
+    l2 = Cache(cfg.l2);
+    predictor = BranchPredictor(cfg.predictor);
+    cycles = 0;
+    set_symbols({});
+}
+
+void TimingModel::set_symbols(const std::vector<ElfSymbol> &symbols)
+{
+    functions.clear();
+    functions.push_back({});
+    functions[0].name = "[unknown]";
+
+    for (const ElfSymbol &s : symbols)
+    {
+        FunctionStats f;
+        f.name = s.name;
+        f.lo = s.addr;
+        f.hi = s.addr + s.size;
+        functions.push_back(f);
+    }
+
+    std::sort(functions.begin() + 1, functions.end(),
+              [](const FunctionStats &a, const FunctionStats &b)
+              { return a.lo < b.lo; });
+
+    // Hand-written assembly often leaves st_size at 0: let such a
+    // symbol run up to the next one.
+    for (size_t i = 1; i + 1 < functions.size(); i++)
+        if (functions[i].hi == functions[i].lo)
+            functions[i].hi = functions[i + 1].lo;
+
+    current = &functions[0];
+}
+
+TimingModel::FunctionStats &TimingModel::lookup(uint32_t pc)
+{
+    auto it = std::upper_bound(functions.begin() + 1, functions.end(), pc,
+                               [](uint32_t v, const FunctionStats &f)
+                               { return v < f.lo; });
+
+    if (it != functions.begin() + 1 && pc < std::prev(it)->hi)
+        current = &*std::prev(it);
+    else
+        current = &functions[0];
+
+    return *current;
+}
+
+// ------------------------------------------------------------
+// Report
+// ------------------------------------------------------------
+
+static double percent(uint64_t part, uint64_t whole)
+{
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+void TimingModel::report(std::ostream &out, uint64_t instructions, size_t top_functions) const
+{
+    uint64_t branches = predictor.conditionals + predictor.jumps;
+    uint64_t mispredicts = predictor.conditional_misses + predictor.jump_misses;
+
+    out << std::fixed << std::setprecision(2);
+    out << "\n--- Timing model ---\n";
+    out << "Cycles (estimated): " << cycles << "\n";
+    out << "CPI: " << (instructions ? (double)cycles / instructions : 0.0) << "\n";
+    out << "L1I: " << l1i.accesses << " accesses, "
+        << percent(l1i.misses, l1i.accesses) << "% miss\n";
+    out << "L1D: " << l1d.accesses << " accesses, "
+        << percent(l1d.misses, l1d.accesses) << "% miss\n";
+    out << "L2:  " << l2.accesses << " accesses, "
+        << percent(l2.misses, l2.accesses) << "% miss\n";
+    out << "Branches: " << predictor.conditionals << " conditional ("
+        << percent(predictor.conditional_misses, predictor.conditionals)
+        << "% mispredicted), " << predictor.jumps << " jumps ("
+        << percent(predictor.jump_misses, predictor.jumps) << "% mispredicted)\n";
+    out << "Mispredict rate: " << percent(mispredicts, branches) << "%\n";
+
+    std::vector<const FunctionStats *> hot;
+    for (const FunctionStats &f : functions)
+        if (f.instructions)
+            hot.push_back(&f);
+
+    std::sort(hot.begin(), hot.end(),
+              [](const FunctionStats *a, const FunctionStats *b)
+              { return a->cycles > b->cycles; });
+
+    if (hot.size() > top_functions)
+        hot.resize(top_functions);
+
+    out << "\n"
+        << std::setw(7) << "cyc%" << std::setw(14) << "cycles"
+        << std::setw(14) << "insts" << std::setw(7) << "CPI"
+        << std::setw(9) << "i-miss%" << std::setw(9) << "d-miss%"
+        << std::setw(10) << "br-miss%" << "  function\n";
+
+    for (const FunctionStats *f : hot)
+    {
+        out << std::setw(7) << percent(f->cycles, cycles)
+            << std::setw(14) << f->cycles
+            << std::setw(14) << f->instructions
+            << std::setw(7) << (double)f->cycles / f->instructions
+            << std::setw(9) << percent(f->l1i_misses, f->instructions)
+            << std::setw(9) << percent(f->l1d_misses, f->l1d_accesses)
+            << std::setw(10) << percent(f->mispredicts, f->branches)
+            << "  " << f->name << "\n";
+    }
+
+    out << std::defaultfloat;
+}
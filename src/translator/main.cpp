@@ -0,0 +1,495 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "riscv/aot/Runtime.hpp"
+#include "riscv/core/Instruction.hpp"
+#include "riscv/platform/ElfLoader.hpp"
+#include "riscv/platform/MemoryLayout.hpp"
+
+// ============================================================
+// Offline RV32IM -> C++ translator
+//
+// Loads a static ELF exactly like bin/emulator, sweeps every
+// executable segment, recovers basic blocks and emits one C++
+// function per block (see riscv/aot/Runtime.hpp).
+//
+// Block leaders are the entry point, segment starts, function
+// symbols, branch/JAL targets and every instruction following a
+// control transfer or an untranslated instruction. Instructions
+// the translator does not handle (SYSTEM, unknown encodings)
+// terminate a block and are left to the interpreter at runtime.
+//
+// A load or store that is not the first instruction of its block
+// stores its own PC first, so a trap leaves s.pc at the faulting
+// instruction just as the interpreter does.
+//
+// Text is assumed to be immutable after load; self-modifying
+// guests must use bin/emulator.
+// ============================================================
+
+namespace
+{
+
+struct Range
+{
+    uint32_t base;
+    uint32_t end;
+};
+
+std::string hex(uint32_t v)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "0x%08xu", v);
+    return buf;
+}
+
+std::string reg(uint32_t r)
+{
+    return r == 0 ? "0u" : "s.x[" + std::to_string(r) + "]";
+}
+
+std::string quote(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+// Mirrors the set of encodings ExecutionEngine accepts.
+bool is_translatable(const DecodedInstruction &d)
+{
+    switch (d.opcode)
+    {
+    case 0x37:
+    case 0x17:
+    case 0x6F:
+    case 0x67:
+    case 0x13:
+    case 0x33:
+        return true;
+    case 0x63:
+        return d.funct3 != 0x2 && d.funct3 != 0x3;
+    case 0x03:
+        return d.funct3 <= 0x2 || d.funct3 == 0x4 || d.funct3 == 0x5;
+    case 0x23:
+        return d.funct3 <= 0x2;
+    default:
+        return false;
+    }
+}
+
+bool ends_block(const DecodedInstruction &d)
+{
+    return d.opcode == 0x63 || d.opcode == 0x6F || d.opcode == 0x67;
+}
+
+// Emit the body of a single non-control instruction.
+// Returns true if the statement touches guest memory.
+bool emit_op(std::ostream &out, const DecodedInstruction &d, uint32_t pc)
+{
+    const std::string rd = "s.x[" + std::to_string(d.rd) + "]";
+    const std::string a = reg(d.rs1);
+    const std::string b = reg(d.rs2);
+    const std::string imm = hex((uint32_t)d.imm);
+
+    auto set = [&](const std::string &expr)
+    {
+        if (d.rd != 0)
+            out << "    " << rd << " = " << expr << ";\n";
+    };
+
+    switch (d.opcode)
+    {
+    case 0x37: // LUI
+        set(imm);
+        return false;
+
+    case 0x17: // AUIPC
+        set(hex(pc + d.imm));
+        return false;
+
+    case 0x13: // OP-IMM
+        switch (d.funct3)
+        {
+        case 0x0:
+            set(a + " + " + imm);
+            break;
+        case 0x2:
+            set("(uint32_t)((int32_t)" + a + " < " + std::to_string(d.imm) + ")");
+            break;
+        case 0x3:
+            set("(uint32_t)(" + a + " < " + imm + ")");
+            break;
+        case 0x4:
+            set(a + " ^ " + imm);
+            break;
+        case 0x6:
+            set(a + " | " + imm);
+            break;
+        case 0x7:
+            set(a + " & " + imm);
+            break;
+        case 0x1:
+            set(a + " << " + std::to_string(d.imm & 31));
+            break;
+        case 0x5:
+            if (d.funct7 & 0x20)
+                set("(uint32_t)((int32_t)" + a + " >> " + std::to_string(d.imm & 31) + ")");
+            else
+                set(a + " >> " + std::to_string(d.imm & 31));
+            break;
+        }
+        return false;
+
+    case 0x33: // OP / RV32M
+        if (d.funct7 == 0x01)
+        {
+            switch (d.funct3)
+            {
+            case 0x0:
+                set("(uint32_t)((int64_t)(int32_t)" + a + " * (int32_t)" + b + ")");
+                break;
+            case 0x1:
+                set("(uint32_t)(((int64_t)(int32_t)" + a + " * (int32_t)" + b + ") >> 32)");
+                break;
+            case 0x2:
+                set("(uint32_t)(((int64_t)(int32_t)" + a + " * (int64_t)" + b + ") >> 32)");
+                break;
+            case 0x3:
+                set("(uint32_t)(((uint64_t)" + a + " * " + b + ") >> 32)");
+                break;
+            case 0x4:
+                set("aot_div(" + a + ", " + b + ")");
+                break;
+            case 0x5:
+                set("aot_divu(" + a + ", " + b + ")");
+                break;
+            case 0x6:
+                set("aot_rem(" + a + ", " + b + ")");
+                break;
+            case 0x7:
+                set("aot_remu(" + a + ", " + b + ")");
+                break;
+            }
+            return false;
+        }
+
+        switch (d.funct3)
+        {
+        case 0x0:
+            set(a + (d.funct7 ? " - " : " + ") + b);
+            break;
+        case 0x1:
+            set(a + " << (" + b + " & 31)");
+            break;
+        case 0x2:
+            set("(uint32_t)((int32_t)" + a + " < (int32_t)" + b + ")");
+            break;
+        case 0x3:
+            set("(uint32_t)(" + a + " < " + b + ")");
+            break;
+        case 0x4:
+            set(a + " ^ " + b);
+            break;
+        case 0x5:
+            if (d.funct7)
+                set("(uint32_t)((int32_t)" + a + " >> (" + b + " & 31))");
+            else
+                set(a + " >> (" + b + " & 31)");
+            break;
+        case 0x6:
+            set(a + " | " + b);
+            break;
+        case 0x7:
+            set(a + " & " + b);
+            break;
+        }
+        return false;
+
+    case 0x03: // LOAD
+    {
+        static const char *const loads[] = {
+            "(uint32_t)(int8_t)m.read_byte",
+            "(uint32_t)(int16_t)m.read_half",
+            "m.read_word",
+            nullptr,
+            "(uint32_t)m.read_byte",
+            "m.read_half",
+        };
+        std::string expr = std::string(loads[d.funct3]) + "(" + a + " + " + imm + ")";
+        if (d.rd != 0)
+            set(expr);
+        else
+            out << "    (void)" << expr << ";\n";
+        return true;
+    }
+
+    case 0x23: // STORE
+    {
+        static const char *const stores[] = {
+            "m.write_byte(" ,
+            "m.write_half(",
+            "m.write_word(",
+        };
+        static const char *const casts[] = {"(uint8_t)", "(uint16_t)", ""};
+        out << "    " << stores[d.funct3] << a << " + " << imm << ", "
+            << casts[d.funct3] << b << ");\n";
+        return true;
+    }
+    }
+    return false;
+}
+
+// Emit the block terminator for a control-transfer instruction.
+void emit_control(std::ostream &out, const DecodedInstruction &d, uint32_t pc)
+{
+    const std::string a = reg(d.rs1);
+    const std::string b = reg(d.rs2);
+
+    switch (d.opcode)
+    {
+    case 0x6F: // JAL
+        if (d.rd != 0)
+            out << "    s.x[" << (int)d.rd << "] = " << hex(pc + 4) << ";\n";
+        out << "    s.pc = " << hex(pc + d.imm) << ";\n";
+        return;
+
+    case 0x67: // JALR
+        out << "    uint32_t target = (" << a << " + " << hex((uint32_t)d.imm) << ") & ~1u;\n";
+        if (d.rd != 0)
+            out << "    s.x[" << (int)d.rd << "] = " << hex(pc + 4) << ";\n";
+        out << "    s.pc = target;\n";
+        return;
+
+    case 0x63: // BRANCH
+    {
+        std::string cond;
+        switch (d.funct3)
+        {
+        case 0x0:
+            cond = a + " == " + b;
+            break;
+        case 0x1:
+            cond = a + " != " + b;
+            break;
+        case 0x4:
+            cond = "(int32_t)" + a + " < (int32_t)" + b;
+            break;
+        case 0x5:
+            cond = "(int32_t)" + a + " >= (int32_t)" + b;
+            break;
+        case 0x6:
+            cond = a + " < " + b;
+            break;
+        case 0x7:
+            cond = a + " >= " + b;
+            break;
+        }
+        out << "    s.pc = (" << cond << ") ? " << hex(pc + d.imm)
+            << " : " << hex(pc + 4) << ";\n";
+        return;
+    }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *elf = nullptr;
+    const char *out_path = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            out_path = argv[++i];
+        else if (!strcmp(argv[i], "--help"))
+        {
+            std::cout << "Usage: translator program.elf -o program.aot.cpp\n"
+                         "Offline RV32IM to C++ translator\n";
+            return 0;
+        }
+        else
+            elf = argv[i];
+    }
+
+    if (!elf || !out_path)
+    {
+        std::cerr << "Usage: translator program.elf -o program.aot.cpp\n";
+        return 1;
+    }
+
+    MemorySubsystem<32> memory(default_memory_map());
+    ArchitecturalState<32> state;
+    ElfImageInfo info;
+
+    ElfLoader::load(elf, memory, state, &info);
+
+    // ---------------- Executable ranges ----------------
+    std::vector<Range> text;
+    for (const auto &seg : info.segments)
+    {
+        if (seg.executable && seg.memsz >= 4)
+            text.push_back({(seg.vaddr + 3) & ~3u, (seg.vaddr + seg.memsz) & ~3u});
+    }
+
+    auto in_text = [&](uint32_t addr)
+    {
+        for (const auto &r : text)
+        {
+            if (addr >= r.base && addr < r.end)
+                return !(addr & 3);
+        }
+        return false;
+    };
+
+    // ---------------- Leaders ----------------
+    std::set<uint32_t> leaders;
+    auto add_leader = [&](uint32_t addr)
+    {
+        if (in_text(addr))
+            leaders.insert(addr);
+    };
+
+    add_leader(info.entry);
+    for (const auto &f : info.functions)
+        add_leader(f.addr);
+
+    for (const auto &r : text)
+    {
+        add_leader(r.base);
+        for (uint32_t pc = r.base; pc < r.end; pc += 4)
+        {
+            DecodedInstruction d = decode_instruction(memory.read_word(pc));
+            if (!is_translatable(d))
+            {
+                add_leader(pc + 4);
+                continue;
+            }
+            if (d.opcode == 0x63 || d.opcode == 0x6F)
+                add_leader(pc + d.imm);
+            if (ends_block(d))
+                add_leader(pc + 4);
+        }
+    }
+
+    // ---------------- Emit ----------------
+    std::ofstream out(out_path);
+    if (!out)
+    {
+        std::cerr << "Failed to open " << out_path << "\n";
+        return 1;
+    }
+
+    out << "// Generated by translator from " << elf << ". Do not edit.\n"
+        << "#include \"riscv/aot/Runtime.hpp\"\n\n"
+        << "using State = ArchitecturalState<32>;\n"
+        << "using Memory = MemorySubsystem<32>;\n\n";
+
+    struct Emitted
+    {
+        uint32_t pc;
+        uint32_t length;
+    };
+    std::vector<Emitted> blocks;
+
+    for (const auto &r : text)
+    {
+        uint32_t pc = r.base;
+        while (pc < r.end)
+        {
+            DecodedInstruction d = decode_instruction(memory.read_word(pc));
+            if (!is_translatable(d))
+            {
+                pc += 4;
+                continue;
+            }
+
+            const uint32_t start = pc;
+            uint32_t length = 0;
+            bool uses_memory = false;
+            std::ostringstream body;
+
+            for (;;)
+            {
+                length++;
+                if (ends_block(d))
+                {
+                    emit_control(body, d, pc);
+                    pc += 4;
+                    break;
+                }
+
+                // Loads and stores can trap. Leave the faulting PC in
+                // s.pc so the runtime can count what retired before it
+                // (it already holds the block's first PC on entry).
+                if ((d.opcode == 0x03 || d.opcode == 0x23) && pc != start)
+                    body << "    s.pc = " << hex(pc) << ";\n";
+
+                uses_memory |= emit_op(body, d, pc);
+                pc += 4;
+
+                if (pc >= r.end || leaders.count(pc))
+                {
+                    body << "    s.pc = " << hex(pc) << ";\n";
+                    break;
+                }
+
+                d = decode_instruction(memory.read_word(pc));
+                if (!is_translatable(d))
+                {
+                    body << "    s.pc = " << hex(pc) << ";\n";
+                    break;
+                }
+            }
+
+            char name[16];
+            snprintf(name, sizeof(name), "b_%08x", start);
+            out << "static void " << name << "(State &s, Memory &"
+                << (uses_memory ? "m" : "") << ")\n{\n"
+                << body.str() << "}\n\n";
+
+            blocks.push_back({start, length});
+        }
+    }
+
+    out << "const AotBlock aot_blocks[] = {\n";
+    for (const auto &b : blocks)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "b_%08x", b.pc);
+        out << "    {" << hex(b.pc) << ", " << b.length << ", " << name << "},\n";
+    }
+    out << "};\n"
+        << "const size_t aot_block_count = sizeof(aot_blocks) / sizeof(aot_blocks[0]);\n\n";
+
+    std::vector<AotTextRange> ranges;
+    out << "const AotTextRange aot_text[] = {\n";
+    for (const auto &r : text)
+    {
+        ranges.push_back({r.base, r.end - r.base});
+        out << "    {" << hex(r.base) << ", " << hex(r.end - r.base) << "},\n";
+    }
+    out << "};\n"
+        << "const size_t aot_text_count = " << ranges.size() << ";\n\n";
+
+    char hash[32];
+    snprintf(hash, sizeof(hash), "0x%016llxull",
+             (unsigned long long)aot_hash_text(memory, ranges.data(), ranges.size()));
+    out << "const uint64_t aot_text_hash = " << hash << ";\n"
+        << "const char *const aot_image_path = " << quote(elf) << ";\n";
+
+    std::cerr << "Translated " << blocks.size() << " blocks from " << elf << "\n";
+    return 0;
+}
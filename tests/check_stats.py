@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# --stats-out must produce one valid JSON object per line, with
+# cumulative counters that never go backwards, ending with the
+# run's final instruction count. A store outside the memory map
+# must be counted in the final `memory` entry.
+#
+#   tests/check_stats.py <emulator> <program.elf> <efault.elf>
+#
+# The second guest must store to an unmapped address on 'S'
+# (demo/tests/efault.elf).
+
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+
+def collect(emulator, elf, out, stdin):
+    run = subprocess.run([emulator, "--stats-interval", "1", "--stats-out", out, elf],
+                         input=stdin, stdout=subprocess.DEVNULL,
+                         stderr=subprocess.PIPE, check=True)
+    total = int(re.search(rb"^Instructions: (\d+)$", run.stderr, re.M).group(1))
+
+    with open(out) as f:
+        lines = f.read().splitlines()
+    if not lines:
+        sys.exit("no samples written")
+
+    last = {}
+    for n, line in enumerate(lines, 1):
+        try:
+            sample = json.loads(line)
+        except ValueError as e:
+            sys.exit("line %d is not JSON (%s): %s" % (n, e, line))
+
+        for key in ("instret", "t_ms", "bytes_in", "bytes_out"):
+            if sample[key] < last.get(key, 0):
+                sys.exit("line %d: %s went backwards" % (n, key))
+            last[key] = sample[key]
+        if "classes" not in sample or "memory" not in sample:
+            sys.exit("line %d: single-guest run without instruction counters" % n)
+
+    if last["instret"] != total:
+        sys.exit("final sample has instret %d, run retired %d" % (last["instret"], total))
+    return sample
+
+
+def main():
+    emulator, elf, efault = sys.argv[1:4]
+    tmp = tempfile.mkdtemp()
+    try:
+        collect(emulator, elf, os.path.join(tmp, "stats.jsonl"), b"")
+
+        sample = collect(emulator, efault, os.path.join(tmp, "fault.jsonl"), b"S")
+        outside = sample["memory"][-1]
+        if outside["base"] is not None or outside["stores"] != 1:
+            sys.exit("faulting store not counted outside the map: %s" % outside)
+    finally:
+        shutil.rmtree(tmp)
+
+
+if __name__ == "__main__":
+    main()
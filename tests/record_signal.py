@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# `emulator --record` must leave a usable log however it ends:
+#   - stopped by SIGINT while the guest waits for input, the log
+#     holds everything up to that point and replays it
+#   - a log that cannot be written fails the run loudly instead
+#     of truncating it
+#
+#   tests/record_signal.py <emulator> <echo.elf>
+#
+# The guest must echo each line it reads (demo/tests/efault.elf).
+
+import os
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def main():
+    emulator, elf = sys.argv[1:3]
+    tmp = tempfile.mkdtemp()
+    log = os.path.join(tmp, "log")
+    try:
+        rec = subprocess.Popen([emulator, "--record", log, elf],
+                               stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                               stderr=subprocess.DEVNULL)
+        rec.stdin.write(b"hello\n")
+        rec.stdin.flush()
+        if rec.stdout.read(6) != b"hello\n":
+            sys.exit("guest does not echo")
+        time.sleep(0.2)  # let it block in read()
+        rec.send_signal(signal.SIGINT)
+        if rec.wait(timeout=5) != -signal.SIGINT:
+            sys.exit("recording did not stop on SIGINT (%d)" % rec.returncode)
+
+        rep = subprocess.run([emulator, "--replay", log, elf], stdin=subprocess.DEVNULL,
+                             stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=5)
+        if rep.stdout != b"hello\n":
+            sys.exit("replay of an interrupted recording printed %r" % rep.stdout)
+        if b"log ended" not in rep.stderr:
+            sys.exit("replay did not report where the log ends")
+
+        full = subprocess.run([emulator, "--record", "/dev/full", elf], input=b"hi\n",
+                              stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, timeout=5)
+        if full.returncode == 0 or b"Cannot write replay log" not in full.stderr:
+            sys.exit("unwritable log not reported")
+    finally:
+        shutil.rmtree(tmp)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+# A guest that faults inside a syscall must not take down the
+# other guests of an `emulator --serve` process.
+#
+#   tests/serve_fault.py <emulator> <efault.elf>
+
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def recv_until(sock, token):
+    data = b""
+    while token not in data:
+        chunk = sock.recv(4096)
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+
+def main():
+    emulator, elf = sys.argv[1:3]
+    path = os.path.join(tempfile.mkdtemp(), "serve.sock")
+    server = subprocess.Popen([emulator, "--serve", path, elf],
+                              stderr=subprocess.DEVNULL)
+    try:
+        for _ in range(100):
+            if os.path.exists(path):
+                break
+            time.sleep(0.05)
+
+        healthy = socket.socket(socket.AF_UNIX)
+        healthy.connect(path)
+        faulty = socket.socket(socket.AF_UNIX)
+        faulty.connect(path)
+        healthy.settimeout(5)
+        faulty.settimeout(5)
+
+        faulty.sendall(b"b0123456789")
+        if b"EFAULT" not in recv_until(faulty, b"\n"):
+            sys.exit("faulting guest did not get -EFAULT")
+
+        healthy.sendall(b"hello\n")
+        if recv_until(healthy, b"\n") != b"hello\n":
+            sys.exit("healthy guest lost its session")
+
+        if server.poll() is not None:
+            sys.exit("server exited with %d" % server.returncode)
+    finally:
+        server.kill()
+        server.wait()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+# `emulator --serve` under resource pressure:
+#   - running out of file descriptors must not spin the event loop,
+#     and queued connections are accepted once guests exit
+#   - a guest that cannot be loaded closes only its own connection
+#   - ecall traps count each ECALL once, even when it blocks
+#
+#   tests/serve_limits.py <emulator> <echo.elf>
+#
+# The guest must echo each line it reads (demo/tests/efault.elf).
+
+import json
+import os
+import resource
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+FD_LIMIT = 16
+CLIENTS = 24
+
+
+def recv_until(sock, token):
+    data = b""
+    while token not in data:
+        chunk = sock.recv(4096)
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+
+def echo(sock, line):
+    sock.sendall(line)
+    return recv_until(sock, b"\n") == line
+
+
+def cpu_seconds(pid):
+    with open("/proc/%d/stat" % pid) as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def connect(path):
+    s = socket.socket(socket.AF_UNIX)
+    s.settimeout(5)
+    s.connect(path)
+    return s
+
+
+def limit_fds():
+    resource.setrlimit(resource.RLIMIT_NOFILE, (FD_LIMIT, FD_LIMIT))
+
+
+def main():
+    emulator, elf = sys.argv[1:3]
+    tmp = tempfile.mkdtemp()
+    path = os.path.join(tmp, "serve.sock")
+    image = os.path.join(tmp, "guest.elf")
+    stats = os.path.join(tmp, "stats.jsonl")
+    shutil.copy(elf, image)
+
+    server = subprocess.Popen([emulator, "--serve", path, "--stats-interval", "50",
+                               "--stats-out", stats, image],
+                              stderr=subprocess.DEVNULL, preexec_fn=limit_fds)
+    clients = []
+    try:
+        for _ in range(100):
+            if os.path.exists(path):
+                break
+            time.sleep(0.05)
+
+        healthy = connect(path)
+        time.sleep(0.2)  # let it block in read()
+        if not echo(healthy, b"hello\n"):
+            sys.exit("first guest does not echo")
+
+        # More connections than descriptors: the rest wait in the backlog.
+        clients = [connect(path) for _ in range(CLIENTS)]
+        time.sleep(0.2)
+        before = cpu_seconds(server.pid)
+        time.sleep(1.0)
+        busy = cpu_seconds(server.pid) - before
+        if busy > 0.3:
+            sys.exit("event loop spins with descriptors exhausted (%.2fs CPU)" % busy)
+
+        if not echo(healthy, b"still here\n"):
+            sys.exit("running guest stalled while descriptors were exhausted")
+
+        # Every queued connection gets a guest once others exit.
+        for c in clients:
+            c.close()
+        clients = []
+        late = connect(path)
+        if not echo(late, b"late\n"):
+            sys.exit("connection after descriptor exhaustion was not served")
+        late.close()
+
+        # A guest that fails to load only loses its own connection.
+        with open(image, "wb") as f:
+            f.write(b"not an elf")
+        broken = connect(path)
+        if broken.recv(4096) != b"":
+            sys.exit("connection with an unloadable guest was not closed")
+        broken.close()
+        shutil.copy(elf, image)
+
+        if not echo(healthy, b"after\n"):
+            sys.exit("running guest lost its session after a failed spawn")
+        if server.poll() is not None:
+            sys.exit("server exited with %d" % server.returncode)
+
+        # With no ECALL left blocked, every trap has completed a call.
+        healthy.close()
+        time.sleep(0.3)
+        with open(stats) as f:
+            last = json.loads(f.read().splitlines()[-1])
+        calls = sum(c["calls"] for c in last["syscalls"].values())
+        blocked = sum(c["blocked"] for c in last["syscalls"].values())
+        if blocked == 0 or last["traps"]["ecall"] != calls - blocked:
+            sys.exit("ecall traps %d, syscalls %d calls / %d blocked"
+                     % (last["traps"]["ecall"], calls, blocked))
+    finally:
+        for c in clients:
+            c.close()
+        server.kill()
+        server.wait()
+        shutil.rmtree(tmp)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+# UART output must survive a --serve client that reads slowly:
+# bytes the socket cannot take yet stay buffered, and whatever is
+# left when the guest exits is delivered before the hang-up.
+# Meanwhile other sessions must not wait for that client.
+#
+#   tests/serve_uart.py <emulator> <mmio.elf>
+
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+FLOOD = 200000
+MAX_REPLY_S = 0.3
+
+
+def recv_all(sock):
+    data = b""
+    while True:
+        chunk = sock.recv(65536)
+        if not chunk:
+            return data
+        data += chunk
+
+
+def main():
+    emulator, elf = sys.argv[1:3]
+    path = os.path.join(tempfile.mkdtemp(), "serve.sock")
+    server = subprocess.Popen([emulator, "--serve", path, elf],
+                              stderr=subprocess.DEVNULL)
+    try:
+        for _ in range(100):
+            if os.path.exists(path):
+                break
+            time.sleep(0.05)
+
+        other = socket.socket(socket.AF_UNIX)
+        other.connect(path)
+        other.settimeout(10)
+
+        client = socket.socket(socket.AF_UNIX)
+        client.connect(path)
+        client.settimeout(10)
+        client.sendall(b"f")
+
+        # Let the guest run into a full socket buffer and exit.
+        time.sleep(0.3)
+
+        start = time.monotonic()
+        other.sendall(b"n")
+        reply = recv_all(other)
+        elapsed = time.monotonic() - start
+        if b"mmio ok" not in reply:
+            sys.exit("other guest failed: %r" % reply[:200])
+        if elapsed > MAX_REPLY_S:
+            sys.exit("other session stalled %.2fs behind a slow client" % elapsed)
+
+        data = recv_all(client)
+        if b"mmio ok" not in data:
+            sys.exit("guest failed: %r" % data[:200])
+        if data.count(b"x") != FLOOD or b"\nend\n" not in data:
+            sys.exit("UART output lost: got %d of %d bytes" % (data.count(b"x"), FLOOD))
+    finally:
+        server.kill()
+        server.wait()
+
+
+if __name__ == "__main__":
+    main()